@@ -7,181 +7,260 @@
 #include "../include/GCanvas.h"
 #include "../include/GRect.h"
 #include "../include/GTime.h"
+#include <algorithm>
 #include <stdio.h>
+#include <string.h>
+
+/*
+ *  The backend independent half of GWindow: damage tracking, drawing (optionally on a render
+ *  thread), and input dispatch. The event loop and the window itself live in GWindow_sdl.cpp
+ *  or GWindow_headless.cpp.
+ */
 
 GClick::GClick(GPoint loc, std::function<void(GClick*)> func) : fFunc(func) {
     fCurr = fPrev = fOrig = loc;
     fState = kDown_State;
 }
 
-GWindow::GWindow(int width, int height) {
-    fClick = NULL;
-    fWidth = width;
-    fHeight = height;
-
-    this->setupBitmap(width, height);
-    fCanvas = GCreateCanvas(fBitmap);
-
-    uint32_t flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
-    fWindow = SDL_CreateWindow("An SDL2 window",
-                               SDL_WINDOWPOS_UNDEFINED,
-                               SDL_WINDOWPOS_UNDEFINED,
-                               width, height, flags);
-    if (!fWindow) {
-        printf("Can't create window: %s\n", SDL_GetError());
-        return;
-    }
-
-    fRenderer = SDL_CreateRenderer(fWindow, -1, 0);
+GWindow::~GWindow() {
+    free(fBitmap.pixels());
+    free(fFront.pixels());
+}
 
-    fTexture = SDL_CreateTexture(fRenderer, SDL_PIXELFORMAT_ARGB8888,
-                                            SDL_TEXTUREACCESS_STREAMING,
-                                            width, height);
+static bool touches(const GIRect& a, const GIRect& b) {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
 
-    fInvalEventType = SDL_RegisterEvents(1);
+static GIRect join(const GIRect& a, const GIRect& b) {
+    return GIRect::LTRB(std::min(a.left, b.left), std::min(a.top, b.top),
+                        std::max(a.right, b.right), std::max(a.bottom, b.bottom));
 }
 
-GWindow::~GWindow() {
-    free(fBitmap.pixels());
+static bool contains(const GIRect& outer, const GIRect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top &&
+           outer.right >= inner.right && outer.bottom >= inner.bottom;
 }
 
-void GWindow::setTitle(const char title[]) {
-    SDL_SetWindowTitle(fWindow, title);
+static GIRect intersect(const GIRect& a, const GIRect& b) {
+    return GIRect::LTRB(std::max(a.left, b.left), std::max(a.top, b.top),
+                        std::min(a.right, b.right), std::min(a.bottom, b.bottom));
 }
 
-void GWindow::pushEvent(int code) const {
-    SDL_Event u;
-    u.type = fInvalEventType;
-    u.user.code = code;
-    u.user.data1 = nullptr;
-    u.user.data2 = nullptr;
-    SDL_PushEvent(&u);
+// Past this many separate areas, redrawing their bounds once is cheaper than drawing the
+// scene over and over.
+static constexpr size_t kMaxDirtyRects = 8;
+
+static void add_dirty(std::vector<GIRect>* dirty, GIRect r) {
+    // Absorb everything r touches (restarting, since the grown r may now touch rects we have
+    // already passed), so the list stays disjoint and no pixel is drawn twice.
+    for (size_t i = 0; i < dirty->size();) {
+        if (touches((*dirty)[i], r)) {
+            r = join((*dirty)[i], r);
+            (*dirty)[i] = dirty->back();
+            dirty->pop_back();
+            i = 0;
+        } else {
+            i += 1;
+        }
+    }
+    dirty->push_back(r);
+
+    if (dirty->size() > kMaxDirtyRects) {
+        for (const GIRect& d : *dirty) {
+            r = join(r, d);
+        }
+        dirty->assign(1, r);
+    }
 }
 
 void GWindow::requestDraw() {
+    this->requestDraw(GIRect::WH(fWidth, fHeight));
+}
+
+void GWindow::requestDraw(const GIRect& r) {
+    GIRect area = intersect(r, GIRect::WH(fWidth, fHeight));
+    if (area.isEmpty()) {
+        return;
+    }
+    add_dirty(&fDirty, area);
+
     if (!fNeedDraw) {
         fNeedDraw = true;
-        this->pushEvent(42);
-    }
-}
-
-bool GWindow::handleEvent(const SDL_Event& evt) {
-//     printf("event %d\n", evt->type);
-    switch (evt.type) {
-        case SDL_WINDOWEVENT:
-            switch (evt.window.event) {
-                case SDL_WINDOWEVENT_RESIZED:
-                    fWidth = evt.window.data1;
-                    fHeight = evt.window.data2;
-                    this->onResize(fWidth, fHeight);
-
-                    SDL_DestroyTexture(fTexture);
-                    fTexture = SDL_CreateTexture(fRenderer,
-                                                 SDL_PIXELFORMAT_ARGB8888,
-                                                 SDL_TEXTUREACCESS_STREAMING,
-                                                 fWidth, fHeight);
-
-                    this->setupBitmap(fWidth, fHeight);
-                    fCanvas = GCreateCanvas(fBitmap);
-                    fNeedDraw = true;
-                    return true;
-            }
-            break;
-        case SDL_KEYDOWN: {
-            unsigned sym = evt.key.keysym.sym;
-            if (evt.key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
-                if (sym >= 'a' && sym <= 'z') {
-                    sym += 'A' - 'a';
-                }
-            }
-            if (this->onKeyPress(sym)) {
-                return true;
-            }
-        } break;
-        case SDL_MOUSEBUTTONDOWN:
-            // seem to get wacky down events when entering a window on mac, but only when
-            // .which is non-zero
-            if (evt.button.which) {
-                break;
-            }
-            if (fClick) {
-                delete fClick;
-            }
-            fClick = this->onFindClickHandler({evt.button.x, evt.button.y});
-            if (fClick) {
-                return true;
-            }
-            break;
-        case SDL_MOUSEBUTTONUP:
-            if (fClick) {
-                fClick->fState = GClick::kUp_State;
-                fClick->callback();
-                delete fClick;
-                fClick = nullptr;
-                return true;
-            }
-            break;
-        case SDL_MOUSEMOTION:
-            if (fClick) {
-                fClick->fState = GClick::kMove_State;
-                fClick->fPrev = fClick->fCurr;
-                fClick->fCurr = {evt.motion.x, evt.motion.y};
-                fClick->callback();
-                return true;
-            }
-            break;
-        default:
-            break;
+        if (fThreaded) {
+            fWake.notify_one();
+        } else {
+            this->wakeEventLoop();
+        }
+    }
+}
+
+bool GWindow::mouseDown(GPoint loc) {
+    if (fClick) {
+        delete fClick;
+    }
+    fClick = this->onFindClickHandler(loc);
+    return fClick != nullptr;
+}
+
+bool GWindow::mouseMove(GPoint loc) {
+    if (fClick) {
+        fClick->fState = GClick::kMove_State;
+        fClick->fPrev = fClick->fCurr;
+        fClick->fCurr = loc;
+        fClick->callback();
+        return true;
     }
     return false;
 }
 
-void GWindow::setupBitmap(int w, int h) {
-    if (fBitmap.pixels()) {
-        free(fBitmap.pixels());
+bool GWindow::mouseUp() {
+    if (fClick) {
+        fClick->fState = GClick::kUp_State;
+        fClick->fPrev = fClick->fCurr;  // so a handler that applies curr - prev sees no motion
+        fClick->callback();
+        delete fClick;
+        fClick = nullptr;
+        return true;
     }
-    size_t rb = w * sizeof(GPixel);
-    fBitmap.reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
+    return false;
 }
 
-static SDL_Rect make(const GIRect& r) {
-    return { r.x(), r.y(), r.width(), r.height() };
+bool GWindow::keyPress(uint32_t sym) {
+    return this->onKeyPress(sym);
 }
 
-static SDL_Rect make(int w, int h) {
-    return { 0, 0, w, h };
+void GWindow::setupBitmap(int w, int h) {
+    free(fBitmap.pixels());
+    fBitmap.alloc(w, h, GBitmap::kAligned_AllocMode);
+    fCanvas = GCreateCanvas(fBitmap);
+
+    free(fFront.pixels());
+    fFront.reset();
+    fFrontCanvas = nullptr;
+    if (fThreaded) {
+        fFront.alloc(w, h, GBitmap::kAligned_AllocMode);
+        fFrontCanvas = GCreateCanvas(fFront);
+    }
+    fStale.clear();
+    fPresented.clear();
 }
 
-void GWindow::drawOverlay(const GIRect* src, const GIRect* dst) {
-    SDL_Rect s = src ? make(*src) : make(fWidth, fHeight);
-    SDL_Rect d = dst ? make(*dst) : make(fWidth, fHeight);
-    SDL_RenderCopy(fRenderer, fTexture, &s, &d);
+void GWindow::resize(int w, int h) {
+    fWidth = w;
+    fHeight = h;
+    this->onResize(fWidth, fHeight);
+
+    {
+        std::lock_guard<std::mutex> lock(fPresentMutex);
+        this->setupBitmap(fWidth, fHeight);
+    }
+    fDirty.clear();
+    this->requestDraw();
 }
 
 void GWindow::onUpdate(const GBitmap& bitmap, GCanvas* canvas) {
     this->onDraw(canvas);
 }
 
-int GWindow::run() {
-    if (!fWindow) {
-        return -1;
+static void copy_area(const GBitmap& src, const GBitmap& dst, const GIRect& r) {
+    for (int y = r.top; y < r.bottom; ++y) {
+        memcpy(dst.getAddr(r.left, y), src.getAddr(r.left, y), r.width() * sizeof(GPixel));
     }
+}
 
-    this->requestDraw();
+void GWindow::drawDirty() {
+    fDrawing.clear();
+    fDrawing.swap(fDirty);  // so onDraw can request the next frame
 
-    SDL_Event e;
-    while (SDL_WaitEvent(&e) && e.type != SDL_QUIT) {
-        this->handleEvent(e);
+    // The back buffer missed the frame in front of it, so bring over what that frame drew,
+    // unless we are about to draw it again anyway.
+    for (const GIRect& s : fStale) {
+        if (std::none_of(fDrawing.begin(), fDrawing.end(),
+                         [&](const GIRect& r) { return contains(r, s); })) {
+            copy_area(fFront, fBitmap, s);
+        }
+    }
+    fStale.clear();
 
-        if (fNeedDraw) {
-            fNeedDraw = false;  // clear this before we call onDraw
+    for (const GIRect& r : fDrawing) {
+        if (r.width() == fWidth && r.height() == fHeight) {
             this->onUpdate(fBitmap, fCanvas.get());
-            SDL_UpdateTexture(fTexture, nullptr, fBitmap.pixels(), fBitmap.rowBytes());
+            continue;
+        }
+
+        // A canvas over the whole window that only writes the damaged pixels: onDraw stays in
+        // window coordinates with the CTM untouched, so the area matches a full redraw exactly.
+        GBitmap area(r.width(), r.height(), fBitmap.rowBytes(), fBitmap.getAddr(r.left, r.top),
+                     false);
+        auto canvas = GCreateCanvas(fBitmap, r);
+        this->onUpdate(area, canvas.get());
+    }
+}
+
+// Called with fMutex held, and fNeedDraw already cleared.
+void GWindow::drawFrame() {
+    double pixels = 0;
+    for (const GIRect& r : fDirty) {
+        pixels += (double)r.width() * r.height();
+    }
+
+    const GNSec start = GTime::GetNSec();
+    this->drawDirty();
+    const double ms = (GTime::GetNSec() - start) * 1e-6;
+
+    {
+        std::lock_guard<std::mutex> lock(fPresentMutex);
+        for (const GIRect& r : fDrawing) {
+            add_dirty(&fPresented, r);
+        }
+        if (fThreaded) {
+            std::swap(fBitmap, fFront);
+            std::swap(fCanvas, fFrontCanvas);
+            fStale = fDrawing;
+        }
+    }
+    this->frameDrawn(ms, pixels);
+}
+
+// Called on the event thread.
+void GWindow::presentFrames() {
+    std::lock_guard<std::mutex> lock(fPresentMutex);
+    for (const GIRect& r : fPresented) {
+        this->uploadArea(r);
+    }
+    fPresented.clear();
+}
+
+void GWindow::startRenderThread() {
+    fQuit = false;
+    this->setupBitmap(fWidth, fHeight);   // for the front buffer
+    fRenderThread = std::thread([this] { this->renderLoop(); });
+}
+
+// Finishes any frame that has been requested, then waits for the render thread to exit.
+void GWindow::stopRenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fQuit = true;
+    }
+    fWake.notify_one();
+    fRenderThread.join();
+}
+
+void GWindow::renderLoop() {
+    std::unique_lock<std::mutex> lock(fMutex);
+    for (;;) {
+        fWake.wait(lock, [this] { return fNeedDraw || fQuit; });
+        if (!fNeedDraw) {
+            return;
         }
-        SDL_RenderCopy(fRenderer, fTexture, nullptr, nullptr);
-        this->onDrawOverlays();
+        fNeedDraw = false;  // clear this before we call onDraw
+        this->drawFrame();
 
-        SDL_RenderPresent(fRenderer);
+        // let go of fMutex first: woken while we still held it, the event loop's try_to_lock
+        // would fail, and the input it queued during the frame would wait for some other event
+        lock.unlock();
+        this->wakeEventLoop();
+        lock.lock();
     }
-    return 0;
 }
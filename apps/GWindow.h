@@ -5,26 +5,67 @@
 #ifndef GWindow_DEFINED
 #define GWindow_DEFINED
 
+#ifndef G_HEADLESS
 #include <SDL2/SDL.h>
+#endif
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "../include/GBitmap.h"
 #include "../include/GPoint.h"
+#include "../include/GRect.h"
+
+#ifdef G_HEADLESS
+// The SDL key codes the apps handle in onKeyPress(), so they build without SDL.
+enum : uint32_t {
+    SDLK_BACKSPACE = 8,
+    SDLK_DELETE    = 127,
+    SDLK_DOWN      = 0x40000051,
+    SDLK_UP        = 0x40000052,
+};
+#endif
 
 class GCanvas;
 class GClick;
-class GIRect;
 
+/**
+ *  A window that draws with GCanvas. There are two backends, picked at build time:
+ *  GWindow_sdl.cpp shows the window and takes input from SDL, and GWindow_headless.cpp
+ *  (built with G_HEADLESS) draws offscreen, replaying input from a script.
+ */
 class GWindow {
 public:
-    int run();
-
+    /**
+     *  Run the event loop until the window is closed (or the script ends). Both backends take
+     *  --threaded (see setThreaded()); the headless one takes the rest of its options from argv
+     *  as well.
+     */
+    int run(int argc = 0, char const* const* argv = nullptr);
+
+    /**
+     *  Redraw the whole window on the next frame.
+     */
     void requestDraw();
 
+    /**
+     *  Redraw just the pixels inside the rect (in window coordinates) on the next frame.
+     *  Requests accumulate until then, and only the damaged area is drawn and uploaded.
+     */
+    void requestDraw(const GIRect&);
+
 protected:
     GWindow(int initial_width, int initial_height);
     virtual ~GWindow();
 
+    /**
+     *  Called once per damaged area. The bitmap holds just that area's pixels, and the canvas
+     *  draws into it in window coordinates, so anything outside the area is clipped out; what
+     *  lands inside is exactly what a full redraw would draw there.
+     */
     virtual void onUpdate(const GBitmap&, GCanvas*);
     virtual void onDraw(GCanvas*) {}
     virtual void onResize(int w, int h) {}
@@ -32,22 +73,49 @@ protected:
     virtual GClick* onFindClickHandler(GPoint) { return NULL; }
     virtual void onDrawOverlays() {}
 
+    /**
+     *  Draw on a separate render thread, into a back buffer, while the event thread keeps taking
+     *  input and showing the last finished frame. Draw requests that arrive while a frame is
+     *  being drawn are coalesced into the next one. Call this before run().
+     *
+     *  Input handlers and onDraw still never run at the same time: input that arrives during a
+     *  frame is queued, and handled as soon as the frame is done.
+     */
+    void setThreaded(bool threaded) { fThreaded = threaded; }
+
     int width() const { return fWidth; }
     int height() const { return fHeight; }
-    
+
     void setTitle(const char title[]);
     void drawOverlay(const GIRect* src, const GIRect* dst);
 
 
 private:
     GClick*     fClick;
-    
-    GBitmap fBitmap;
+
+    GBitmap fBitmap;                    // what onDraw draws into (the back buffer when threaded)
     std::unique_ptr<GCanvas> fCanvas;
     int fWidth;
     int fHeight;
     bool fNeedDraw;
-
+    std::vector<GIRect> fDirty;     // disjoint areas to redraw on the next frame
+    std::vector<GIRect> fDrawing;   // the areas being redrawn right now
+
+    // The render thread, see setThreaded(). fMutex is held whenever app code (input handlers or
+    // onDraw) runs, and guards fNeedDraw and fDirty. fPresentMutex guards which buffer is in
+    // front, and fPresented.
+    bool                    fThreaded;
+    bool                    fQuit;
+    std::thread             fRenderThread;
+    std::mutex              fMutex;
+    std::condition_variable fWake;
+    std::mutex              fPresentMutex;
+    GBitmap                 fFront;             // the last finished frame, when threaded
+    std::unique_ptr<GCanvas> fFrontCanvas;
+    std::vector<GIRect>     fStale;             // areas of fBitmap that are older than fFront
+    std::vector<GIRect>     fPresented;         // areas of finished frames not yet shown
+
+#ifndef G_HEADLESS
     SDL_Window*   fWindow;
     SDL_Renderer* fRenderer;
     SDL_Texture*  fTexture;
@@ -55,20 +123,46 @@ private:
     uint32_t fInvalEventType;
 
     bool handleEvent(const SDL_Event&);
+#else
+    bool checkFullRedraw();
+#endif
+
+    // Input, shared by the backends. Each returns true if the window handled it.
+    bool mouseDown(GPoint);
+    bool mouseMove(GPoint);
+    bool mouseUp();
+    bool keyPress(uint32_t sym);
+
     void setupBitmap(int w, int h);
-    void pushEvent(int code) const;
+    void resize(int w, int h);
+    const GBitmap& shownBitmap() const { return fThreaded ? fFront : fBitmap; }
+
+    void drawDirty();
+    void drawFrame();
+    void presentFrames();
+
+    void startRenderThread();
+    void stopRenderThread();
+    void renderLoop();
+
+    // Implemented by the backend: wake up the event loop (to draw a frame, or to show one the
+    // render thread has finished), show the pixels of an area of shownBitmap(), and take note
+    // of how long a frame took.
+    void wakeEventLoop();
+    void uploadArea(const GIRect&);
+    void frameDrawn(double ms, double pixels);
 };
 
 class GClick {
 public:
     GClick(GPoint, std::function<void(GClick*)>);
-    
+
     enum State {
         kDown_State,
         kMove_State,
         kUp_State
     };
-    
+
     State state() const { return fState; }
     GPoint curr() const { return fCurr; }
     GPoint prev() const { return fPrev; }
@@ -0,0 +1,358 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "GWindow.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GRect.h"
+#include "../include/GTime.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+/*
+ *  GWindow without a display: the window is just its bitmap, and input comes from a script
+ *  instead of SDL. Each event is dispatched exactly like GWindow_sdl.cpp does, and every frame
+ *  it causes is timed, so interactive workloads can be benchmarked on a build machine. With
+ *  --threaded, frames are drawn on the render thread while the script keeps feeding input, so
+ *  the frames show how requests coalesce.
+ *
+ *  Script syntax, one event per line ('#' starts a comment):
+ *      key <c>                 a key press; <c> is one character, or up, down, delete, backspace
+ *      down <x> <y>            press the mouse button
+ *      move <x> <y>            move the mouse
+ *      up                      release the mouse button
+ *      drag <x0> <y0> <x1> <y1> [steps]
+ *                              down, then steps (default 8) moves to x1,y1, then up
+ *      resize <w> <h>          resize the window
+ *
+ *  With --check, the last frame is then drawn again in full on a fresh canvas, and any pixel the
+ *  partial redraws left different from it is an error.
+ */
+
+GWindow::GWindow(int width, int height) {
+    fClick = NULL;
+    fWidth = width;
+    fHeight = height;
+    fNeedDraw = false;
+    fThreaded = false;
+    fQuit = false;
+
+    this->setupBitmap(width, height);
+}
+
+void GWindow::setTitle(const char title[]) {}
+
+// run() draws (or shows) after every event, so there is nothing to wake up.
+void GWindow::wakeEventLoop() {}
+
+// The bitmap is all there is to show.
+void GWindow::uploadArea(const GIRect&) {}
+
+void GWindow::drawOverlay(const GIRect* src, const GIRect* dst) {}
+
+static bool is_arg(const char arg[], const char name[]) {
+    std::string str("--");
+    str += name;
+    if (!strcmp(arg, str.c_str())) {
+        return true;
+    }
+
+    char shortVers[3];
+    shortVers[0] = '-';
+    shortVers[1] = name[0];
+    shortVers[2] = 0;
+    return !strcmp(arg, shortVers);
+}
+
+static bool parse_key(const char name[], uint32_t* sym) {
+    const struct {
+        const char* fName;
+        uint32_t    fSym;
+    } gNamedKeys[] = {
+        { "up",        SDLK_UP },
+        { "down",      SDLK_DOWN },
+        { "delete",    SDLK_DELETE },
+        { "backspace", SDLK_BACKSPACE },
+    };
+    for (const auto& key : gNamedKeys) {
+        if (!strcmp(name, key.fName)) {
+            *sym = key.fSym;
+            return true;
+        }
+    }
+    if (strlen(name) == 1) {
+        *sym = (unsigned char)name[0];
+        return true;
+    }
+    return false;
+}
+
+struct ScriptEvent {
+    enum Type {
+        kKey,
+        kDown,
+        kMove,
+        kUp,
+        kResize,
+    } fType;
+    GPoint   fLoc;      // kDown, kMove; (w, h) for kResize
+    uint32_t fSym;      // kKey
+};
+
+static bool parse_script(const char path[], std::vector<ScriptEvent>* events) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("can't open script %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    bool ok = true;
+    for (int lineNum = 1; ok && fgets(line, sizeof(line), f); ++lineNum) {
+        char op[32] = "", arg[32] = "";
+        float x0, y0, x1, y1;
+        int steps = 8;
+
+        if (sscanf(line, " %31s", op) != 1 || op[0] == '#') {
+            continue;
+        }
+        if (!strcmp(op, "key")) {
+            uint32_t sym;
+            ok = sscanf(line, " %*s %31s", arg) == 1 && parse_key(arg, &sym);
+            events->push_back({ScriptEvent::kKey, {0, 0}, sym});
+        } else if (!strcmp(op, "down") || !strcmp(op, "move")) {
+            ok = sscanf(line, " %*s %f %f", &x0, &y0) == 2;
+            events->push_back({op[0] == 'd' ? ScriptEvent::kDown : ScriptEvent::kMove,
+                               {x0, y0}, 0});
+        } else if (!strcmp(op, "up")) {
+            events->push_back({ScriptEvent::kUp, {0, 0}, 0});
+        } else if (!strcmp(op, "drag")) {
+            ok = sscanf(line, " %*s %f %f %f %f %d", &x0, &y0, &x1, &y1, &steps) >= 4 &&
+                 steps > 0;
+            events->push_back({ScriptEvent::kDown, {x0, y0}, 0});
+            for (int s = 1; ok && s <= steps; ++s) {
+                const float t = (float)s / steps;
+                events->push_back({ScriptEvent::kMove,
+                                   {x0 + (x1 - x0) * t, y0 + (y1 - y0) * t}, 0});
+            }
+            events->push_back({ScriptEvent::kUp, {0, 0}, 0});
+        } else if (!strcmp(op, "resize")) {
+            ok = sscanf(line, " %*s %f %f", &x0, &y0) == 2 && x0 >= 1 && y0 >= 1;
+            events->push_back({ScriptEvent::kResize, {x0, y0}, 0});
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printf("%s:%d: can't parse: %s", path, lineNum, line);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+struct FrameStats {
+    std::vector<double> fMillis;    // per frame
+    double fPixels = 0;             // total damaged pixels drawn
+
+    double percentile(double p) const {
+        // fMillis is sorted by print()
+        const size_t n = fMillis.size();
+        return fMillis[std::min(n - 1, (size_t)std::max(ceil(n * p), 1.0) - 1)];
+    }
+
+    void print() {
+        if (fMillis.empty()) {
+            printf("no frames drawn\n");
+            return;
+        }
+        std::sort(fMillis.begin(), fMillis.end());
+        double sum = 0;
+        for (double ms : fMillis) {
+            sum += ms;
+        }
+        const size_t n = fMillis.size();
+        printf("frames %zu  mean %.3f ms  p50 %.3f ms  p99 %.3f ms  max %.3f ms  "
+               "(%.0f damaged px/frame)\n",
+               n, sum / n, this->percentile(0.5), this->percentile(0.99), fMillis.back(),
+               fPixels / n);
+
+        // Histogram with power of 2 buckets, starting at 1/64 ms.
+        const double kFirst = 1.0 / 64;
+        int counts[32] = {};
+        int last = 0;
+        for (double ms : fMillis) {
+            int bucket = 0;
+            for (double limit = kFirst; ms >= limit && bucket < 31; limit *= 2) {
+                bucket += 1;
+            }
+            counts[bucket] += 1;
+            last = std::max(last, bucket);
+        }
+        int most = *std::max_element(counts, counts + 32);
+        for (int i = 0; i <= last; ++i) {
+            const double hi = kFirst * (1 << i);
+            printf("  < %9.3f ms %6d  ", hi, counts[i]);
+            for (int j = 0, bars = (counts[i] * 50 + most - 1) / most; j < bars; ++j) {
+                putchar('#');
+            }
+            putchar('\n');
+        }
+    }
+};
+
+static FrameStats gFrameStats;
+static bool gVerbose;
+
+void GWindow::frameDrawn(double ms, double pixels) {
+    gFrameStats.fMillis.push_back(ms);
+    gFrameStats.fPixels += pixels;
+    if (gVerbose) {
+        printf("%8.3f ms %9.0f px\n", ms, pixels);
+    }
+}
+
+// The partial redraws must leave exactly the pixels a full redraw of the same frame does.
+bool GWindow::checkFullRedraw() {
+    const GBitmap& shown = this->shownBitmap();
+    GPixelBuffer full(shown.width(), shown.height());
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto canvas = GCreateCanvas(full.bitmap());
+        this->onUpdate(full.bitmap(), canvas.get());
+    }
+
+    int diffs = 0;
+    for (int y = 0; y < shown.height(); ++y) {
+        for (int x = 0; x < shown.width(); ++x) {
+            diffs += *shown.getAddr(x, y) != *full->getAddr(x, y);
+        }
+    }
+    if (diffs) {
+        printf("check: %d pixels differ from a full redraw\n", diffs);
+        return false;
+    }
+    printf("check: matches a full redraw\n");
+    return true;
+}
+
+int GWindow::run(int argc, char const* const* argv) {
+    const char* scriptPath = "apps/draw.script";
+    const char* writePath = nullptr;
+    bool check = false;
+    int repeat = 1;
+    double intervalMS = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (is_arg(argv[i], "script") && i+1 < argc) {
+            scriptPath = argv[++i];
+        } else if (is_arg(argv[i], "repeat") && i+1 < argc) {
+            repeat = std::max(atoi(argv[++i]), 1);
+        } else if (is_arg(argv[i], "interval") && i+1 < argc) {
+            intervalMS = std::max(atof(argv[++i]), 0.0);
+        } else if (is_arg(argv[i], "threaded")) {
+            this->setThreaded(true);
+        } else if (is_arg(argv[i], "write") && i+1 < argc) {
+            writePath = argv[++i];
+        } else if (is_arg(argv[i], "verbose")) {
+            gVerbose = true;
+        } else if (is_arg(argv[i], "check")) {
+            check = true;
+        } else {
+            printf("Unknown arg %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    std::vector<ScriptEvent> script;
+    if (!parse_script(scriptPath, &script)) {
+        return -1;
+    }
+
+    auto dispatch = [this](const ScriptEvent& e) {
+        switch (e.fType) {
+            case ScriptEvent::kKey:    this->keyPress(e.fSym); break;
+            case ScriptEvent::kDown:   this->mouseDown(e.fLoc); break;
+            case ScriptEvent::kMove:   this->mouseMove(e.fLoc); break;
+            case ScriptEvent::kUp:     this->mouseUp(); break;
+            case ScriptEvent::kResize: this->resize((int)e.fLoc.x, (int)e.fLoc.y); break;
+        }
+    };
+
+    if (fThreaded) {
+        this->startRenderThread();
+    }
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        this->requestDraw();
+    }
+    if (!fThreaded) {
+        fNeedDraw = false;
+        this->drawFrame();
+    }
+
+    // Same as GWindow_sdl.cpp: when threaded, input that arrives during a frame is queued, with
+    // consecutive moves merged, and handled as soon as the render thread lets go of fMutex.
+    std::vector<ScriptEvent> pending;
+    int events = 0;
+    const GNSec start = GTime::GetNSec();
+
+    for (int pass = 0; pass < repeat; ++pass) {
+        for (const ScriptEvent& e : script) {
+            events += 1;
+            if (intervalMS > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(intervalMS * 1000)));
+            }
+
+            if (!fThreaded) {
+                dispatch(e);
+                if (fNeedDraw) {
+                    fNeedDraw = false;  // clear this before we call onDraw
+                    this->drawFrame();
+                }
+                continue;
+            }
+
+            if (e.fType == ScriptEvent::kMove && !pending.empty() &&
+                pending.back().fType == ScriptEvent::kMove) {
+                pending.back() = e;
+            } else {
+                pending.push_back(e);
+            }
+            std::unique_lock<std::mutex> lock(fMutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                for (const ScriptEvent& p : pending) {
+                    dispatch(p);
+                }
+                pending.clear();
+            }
+        }
+    }
+
+    if (fThreaded) {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            for (const ScriptEvent& p : pending) {
+                dispatch(p);
+            }
+        }
+        this->stopRenderThread();   // after it draws the last frame
+    }
+    this->presentFrames();
+    const double totalMS = (GTime::GetNSec() - start) * 1e-6;
+
+    printf("%d events in %.1f ms, %zu frames\n", events, totalMS, gFrameStats.fMillis.size());
+    gFrameStats.print();
+
+    if (writePath && !this->shownBitmap().writeToFile(writePath)) {
+        printf("failed to write %s\n", writePath);
+        return -1;
+    }
+    if (check && !this->checkFullRedraw()) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#include "GWindow.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GRect.h"
+#include <stdio.h>
+#include <string.h>
+
+GWindow::GWindow(int width, int height) {
+    fClick = NULL;
+    fWidth = width;
+    fHeight = height;
+    fNeedDraw = false;
+    fThreaded = false;
+    fQuit = false;
+
+    this->setupBitmap(width, height);
+
+    uint32_t flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
+    fWindow = SDL_CreateWindow("An SDL2 window",
+                               SDL_WINDOWPOS_UNDEFINED,
+                               SDL_WINDOWPOS_UNDEFINED,
+                               width, height, flags);
+    if (!fWindow) {
+        printf("Can't create window: %s\n", SDL_GetError());
+        return;
+    }
+
+    fRenderer = SDL_CreateRenderer(fWindow, -1, 0);
+
+    fTexture = SDL_CreateTexture(fRenderer, SDL_PIXELFORMAT_ARGB8888,
+                                            SDL_TEXTUREACCESS_STREAMING,
+                                            width, height);
+
+    fInvalEventType = SDL_RegisterEvents(1);
+}
+
+void GWindow::setTitle(const char title[]) {
+    SDL_SetWindowTitle(fWindow, title);
+}
+
+// Safe to call from the render thread, as SDL_PushEvent is.
+void GWindow::wakeEventLoop() {
+    SDL_Event u;
+    u.type = fInvalEventType;
+    u.user.code = 42;
+    u.user.data1 = nullptr;
+    u.user.data2 = nullptr;
+    SDL_PushEvent(&u);
+}
+
+bool GWindow::handleEvent(const SDL_Event& evt) {
+//     printf("event %d\n", evt->type);
+    switch (evt.type) {
+        case SDL_WINDOWEVENT:
+            switch (evt.window.event) {
+                case SDL_WINDOWEVENT_RESIZED:
+                    SDL_DestroyTexture(fTexture);
+                    fTexture = SDL_CreateTexture(fRenderer,
+                                                 SDL_PIXELFORMAT_ARGB8888,
+                                                 SDL_TEXTUREACCESS_STREAMING,
+                                                 evt.window.data1, evt.window.data2);
+
+                    this->resize(evt.window.data1, evt.window.data2);
+                    return true;
+            }
+            break;
+        case SDL_KEYDOWN: {
+            unsigned sym = evt.key.keysym.sym;
+            if (evt.key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
+                if (sym >= 'a' && sym <= 'z') {
+                    sym += 'A' - 'a';
+                }
+            }
+            if (this->keyPress(sym)) {
+                return true;
+            }
+        } break;
+        case SDL_MOUSEBUTTONDOWN:
+            // seem to get wacky down events when entering a window on mac, but only when
+            // .which is non-zero
+            if (evt.button.which) {
+                break;
+            }
+            if (this->mouseDown({(float)evt.button.x, (float)evt.button.y})) {
+                return true;
+            }
+            break;
+        case SDL_MOUSEBUTTONUP:
+            if (this->mouseUp()) {
+                return true;
+            }
+            break;
+        case SDL_MOUSEMOTION:
+            if (this->mouseMove({(float)evt.motion.x, (float)evt.motion.y})) {
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+static SDL_Rect make(const GIRect& r) {
+    return { r.x(), r.y(), r.width(), r.height() };
+}
+
+static SDL_Rect make(int w, int h) {
+    return { 0, 0, w, h };
+}
+
+void GWindow::uploadArea(const GIRect& r) {
+    const GBitmap& bitmap = this->shownBitmap();
+    SDL_Rect rect = make(r);
+    SDL_UpdateTexture(fTexture, &rect, bitmap.getAddr(r.left, r.top), bitmap.rowBytes());
+}
+
+void GWindow::frameDrawn(double ms, double pixels) {}
+
+void GWindow::drawOverlay(const GIRect* src, const GIRect* dst) {
+    SDL_Rect s = src ? make(*src) : make(fWidth, fHeight);
+    SDL_Rect d = dst ? make(*dst) : make(fWidth, fHeight);
+    SDL_RenderCopy(fRenderer, fTexture, &s, &d);
+}
+
+int GWindow::run(int argc, char const* const* argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--threaded")) {
+            this->setThreaded(true);
+        }
+    }
+    if (!fWindow) {
+        return -1;
+    }
+
+    if (fThreaded) {
+        this->startRenderThread();
+    }
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        this->requestDraw();
+    }
+
+    // When threaded, input that arrives during a frame waits here. Consecutive mouse moves are
+    // merged, since a click only needs the latest position. While any is waiting, the loop
+    // polls for fMutex every millisecond rather than sleeping until the next event: the render
+    // thread can take fMutex back just as its wakeup arrives.
+    std::vector<SDL_Event> pending;
+
+    SDL_Event e;
+    for (;;) {
+        const bool got = pending.empty() ? SDL_WaitEvent(&e) : SDL_WaitEventTimeout(&e, 1);
+        if (got ? e.type == SDL_QUIT : pending.empty()) {
+            break;
+        }
+        if (fThreaded) {
+            if (got && e.type != fInvalEventType) {
+                if (e.type == SDL_MOUSEMOTION && !pending.empty() &&
+                    pending.back().type == SDL_MOUSEMOTION) {
+                    pending.back() = e;
+                } else {
+                    pending.push_back(e);
+                }
+            }
+            std::unique_lock<std::mutex> lock(fMutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                for (const SDL_Event& p : pending) {
+                    this->handleEvent(p);
+                }
+                pending.clear();
+            } else if (!got) {
+                continue;   // nothing new to show yet
+            }
+        } else {
+            this->handleEvent(e);
+
+            if (fNeedDraw) {
+                fNeedDraw = false;  // clear this before we call onDraw
+                this->drawFrame();
+            }
+        }
+        this->presentFrames();
+
+        SDL_RenderCopy(fRenderer, fTexture, nullptr, nullptr);
+        this->onDrawOverlays();
+
+        SDL_RenderPresent(fRenderer);
+    }
+
+    if (fThreaded) {
+        this->stopRenderThread();
+    }
+    return 0;
+}
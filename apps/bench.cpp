@@ -3,9 +3,16 @@
  */
 
 #include "bench.h"
+#include "bench_alloc.h"
+#include "bench_perf.h"
+#include "bench_report.h"
+#include "bench_timer.h"
 #include "../include/GCanvas.h"
+#include "../include/GCanvasStats.h"
 #include "../include/GBitmap.h"
 #include "../include/GTime.h"
+#include "../include/GTrace.h"
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,8 +22,7 @@
 constexpr double gMaxBenchMultiplier = 32;   // times slower than mine
 
 static void setup_bitmap(GBitmap* bitmap, int w, int h) {
-    size_t rb = w * sizeof(GPixel);
-    bitmap->reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
+    bitmap->alloc(w, h, GBitmap::kHugePage_AllocMode);
 }
 
 enum Mode {
@@ -25,7 +31,8 @@ enum Mode {
     kOnce,
 };
 
-static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode) {
+static BenchStats handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode,
+                              const BenchTimerOptions& opts) {
     GISize size = bench->size();
     setup_bitmap(bitmap, size.width, size.height);
 
@@ -33,27 +40,248 @@ static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap,
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 size.width, size.height, bench->name());
-        return 0;
+        return BenchStats();
     }
 
-#ifdef NDEBUG
-    int N = 100;
-#else
-    int N = 1;
-#endif
-    bool forever = false;
     switch (mode) {
-        case kNormal: break;
-        case kForever: forever = true; break;
-        case kOnce: N = 4; break;
+        case kNormal:
+            break;
+        case kForever:
+            for (;;) {
+                bench->draw(canvas.get());
+            }
+        case kOnce: {
+            GNSec now = GTime::GetNSec();
+            for (int i = 0; i < 4; ++i) {
+                bench->draw(canvas.get());
+            }
+            return BenchStats::Compute({ (GTime::GetNSec() - now) * 1e-6 / 4 }, 4);
+        }
     }
 
-    GMSec now = GTime::GetMSec();
-    for (int i = 0; i < N || forever; ++i) {
+    return time_bench([&]() { bench->draw(canvas.get()); }, opts);
+}
+
+/*
+ *  Draw a fresh instance of the bench once into a fresh bitmap, so the checksum does not depend
+ *  on how many iterations the timing loop ran.
+ */
+static uint64_t checksum_bench(GBenchmark::Factory factory) {
+    std::unique_ptr<GBenchmark> bench(factory());
+    GISize size = bench->size();
+    GPixelBuffer pixels(size.width, size.height);
+    auto canvas = GCreateCanvas(pixels.bitmap());
+    if (!canvas) {
+        return 0;
+    }
+    bench->draw(canvas.get());
+    return checksum_bitmap(pixels.bitmap());
+}
+
+/*
+ *  Run iters draws of the bench into its (already set up) bitmap under the hardware counters,
+ *  and print them per device pixel.
+ */
+static void print_bench_perf(GBenchmark* bench, const GBitmap& bitmap, int iters,
+                             PerfCounters* perf) {
+    auto canvas = GCreateCanvas(bitmap);
+    if (!canvas) {
+        return;
+    }
+    iters = std::max(iters, 1);
+    perf->start();
+    for (int i = 0; i < iters; ++i) {
         bench->draw(canvas.get());
     }
-    GMSec dur = GTime::GetMSec() - now;
-    return dur * 1.0 / N;
+    perf->stop();
+
+    const double pixels = (double)iters * bitmap.width() * bitmap.height();
+    int64_t cycles = perf->value(PerfCounters::kCycles);
+    int64_t instructions = perf->value(PerfCounters::kInstructions);
+    if (cycles > 0 && instructions >= 0) {
+        printf("    IPC %.2f", (double)instructions / cycles);
+    } else {
+        printf("    IPC n/a");
+    }
+    printf("  per pixel:");
+    for (int i = 0; i < PerfCounters::kCount; ++i) {
+        int64_t value = perf->value(i);
+        if (value >= 0) {
+            printf(" %s %.3g", PerfCounters::Name(i), value / pixels);
+        } else {
+            printf(" %s n/a", PerfCounters::Name(i));
+        }
+    }
+    printf("\n");
+}
+
+/*
+ *  Run iters draws of the bench into its (already set up) bitmap while counting heap
+ *  allocations, after one uncounted draw so lazily built state is not charged to the loop.
+ *  Print them per draw along with the peak RSS, and return true if the draw loop allocated.
+ */
+static bool print_bench_allocs(GBenchmark* bench, const GBitmap& bitmap, int iters) {
+    auto canvas = GCreateCanvas(bitmap);
+    if (!canvas) {
+        return false;
+    }
+    iters = std::max(iters, 1);
+    bench->draw(canvas.get());
+
+    AllocCounts before = AllocTracker::Counts();
+    AllocTracker::SetEnabled(true);
+    for (int i = 0; i < iters; ++i) {
+        bench->draw(canvas.get());
+    }
+    AllocTracker::SetEnabled(false);
+    AllocCounts after = AllocTracker::Counts();
+
+    const uint64_t count = after.fCount - before.fCount;
+    const uint64_t bytes = after.fBytes - before.fBytes;
+    printf("    allocs/draw %.3g  bytes/draw %.3g  peak RSS %lld KB%s\n",
+           (double)count / iters, (double)bytes / iters, (long long)peak_rss_kb(),
+           count ? "  ALLOCATES IN DRAW LOOP" : "");
+    return count > 0;
+}
+
+/*
+ *  Draw a fresh instance of each bench once, one after the other, with draw tracing on, and
+ *  write the events to path. Tracing is kept out of the timed loops so it cannot skew them.
+ */
+static bool trace_benches(const std::vector<GBenchmark::Factory>& factories, const char path[]) {
+    GTraceBegin();
+    for (auto factory : factories) {
+        std::unique_ptr<GBenchmark> bench(factory());
+        GISize size = bench->size();
+        GPixelBuffer pixels(size.width, size.height);
+        auto canvas = GCreateCanvas(pixels.bitmap());
+        if (canvas) {
+            bench->draw(canvas.get());
+        }
+    }
+    return GTraceEnd(path);
+}
+
+/*
+ *  Draw a fresh instance of the bench once, and print the canvas's pipeline counters.
+ */
+static void print_bench_stats(GBenchmark::Factory factory) {
+    std::unique_ptr<GBenchmark> bench(factory());
+    GISize size = bench->size();
+    GPixelBuffer pixels(size.width, size.height);
+    auto canvas = GCreateCanvas(pixels.bitmap());
+    if (!canvas) {
+        return;
+    }
+    bench->draw(canvas.get());
+
+    const GCanvasStats* stats = canvas->getStats();
+    if (!stats) {
+        printf("    (no stats: build with G_STATS, e.g. make sbench)\n");
+        return;
+    }
+    auto line = [](const char label[], uint64_t value) {
+        if (value) {
+            printf("    %-28s %12llu\n", label, (unsigned long long)value);
+        }
+    };
+    line("edges built", stats->fEdgesBuilt);
+    line("edges clipped", stats->fEdgesClipped);
+    line("scanlines", stats->fScanlines);
+    line("spans", stats->fSpans);
+    for (int mode = 0; mode < GCanvasStats::kBlendModeCount; ++mode) {
+        for (int ac = 0; ac < GCanvasStats::kAlphaClassCount; ++ac) {
+            std::string label = std::string("blit ") + GCanvasStats::BlendModeName(mode) + " " +
+                                GCanvasStats::AlphaClassName(ac);
+            line(label.c_str(), stats->fBlitPixels[mode][ac]);
+        }
+    }
+    for (int type = 0; type < GCanvasStats::kShaderTypeCount; ++type) {
+        std::string label = std::string("shaded ") + GCanvasStats::ShaderTypeName(type);
+        line(label.c_str(), stats->fShadedPixels[type]);
+    }
+}
+
+/*
+ *  Time every bench of the scaling matrix (or those whose axis or name contains match), and
+ *  print a table of throughput per axis: a list for 1D axes, a grid for 2D ones.
+ */
+static void run_scaling(const char* match, const BenchTimerOptions& timer) {
+    std::vector<GScalingBench> benches;
+    GetScalingBenches(&benches);
+
+    struct Point {
+        const GScalingBench* fBench;
+        double fMS;
+    };
+    std::vector<Point> points;
+    for (const GScalingBench& sb : benches) {
+        std::unique_ptr<GBenchmark> bench(sb.fFactory());
+        if (match && !strstr(sb.fAxis.c_str(), match) && !strstr(bench->name(), match)) {
+            continue;
+        }
+        GBitmap bitmap;
+        BenchStats stats = handle_proc(bench.get(), bench->name(), &bitmap, kNormal, timer);
+        free(bitmap.pixels());
+        points.push_back({&sb, stats.fMedian});
+    }
+
+    // millions of units per second
+    auto throughput = [](const Point& p) {
+        return p.fMS > 0 ? p.fBench->fUnits / (p.fMS * 1e3) : 0;
+    };
+
+    for (size_t i = 0; i < points.size(); ) {
+        const std::string& axis = points[i].fBench->fAxis;
+        size_t end = i;
+        while (end < points.size() && points[end].fBench->fAxis == axis) {
+            end++;
+        }
+
+        if (points[i].fBench->fColumn.empty()) {
+            printf("\n%-20s %12s %12s %8s\n", axis.c_str(), "ms/draw",
+                   (std::string("M") + points[i].fBench->fUnit + "/s").c_str(), "rel");
+            const double first = throughput(points[i]);
+            for (size_t k = i; k < end; ++k) {
+                double tp = throughput(points[k]);
+                printf("  %-18s %12.4g %12.4g %8.2f\n", points[k].fBench->fRow.c_str(),
+                       points[k].fMS, tp, first > 0 ? tp / first : 0);
+            }
+        } else {
+            // rows and columns in the order they were first seen
+            std::vector<std::string> rows, cols;
+            for (size_t k = i; k < end; ++k) {
+                const GScalingBench* b = points[k].fBench;
+                if (std::find(rows.begin(), rows.end(), b->fRow) == rows.end()) {
+                    rows.push_back(b->fRow);
+                }
+                if (std::find(cols.begin(), cols.end(), b->fColumn) == cols.end()) {
+                    cols.push_back(b->fColumn);
+                }
+            }
+            printf("\n%s (M%s/s)\n  %-16s", axis.c_str(), points[i].fBench->fUnit, "");
+            for (const std::string& col : cols) {
+                printf(" %9s", col.c_str());
+            }
+            printf("\n");
+            for (const std::string& row : rows) {
+                printf("  %-16s", row.c_str());
+                for (const std::string& col : cols) {
+                    auto p = std::find_if(points.begin() + i, points.begin() + end,
+                                          [&](const Point& p) {
+                        return p.fBench->fRow == row && p.fBench->fColumn == col;
+                    });
+                    if (p != points.begin() + end) {
+                        printf(" %9.4g", throughput(*p));
+                    } else {
+                        printf(" %9s", "-");
+                    }
+                }
+                printf("\n");
+            }
+        }
+        i = end;
+    }
 }
 
 static bool is_arg(const char arg[], const char name[]) {
@@ -94,6 +322,22 @@ int main_bench(int argc, const char* argv[]) {
     std::vector<double> inScores;
     bool chatty_mode = true;
     bool write_images = false;
+    bool print_stats = false;
+    bool use_perf = false;
+    bool track_allocs = false;
+    bool scaling = false;
+    const char* jsonFile = nullptr;
+    const char* csvFile = nullptr;
+    const char* baselineFile = nullptr;
+    const char* traceFile = nullptr;
+    double threshold = 0.05;
+    BenchTimerOptions timer;
+#ifndef NDEBUG
+    // debug builds are no good for timing, just run each bench once
+    timer.fWarmupMS = 0;
+    timer.fBudgetMS = 0;
+    timer.fSamples = 1;
+#endif
 
     int count = -1;
     while (gBenchFactories[++count]);
@@ -118,6 +362,33 @@ int main_bench(int argc, const char* argv[]) {
             chatty_mode = false;
         } else if (is_arg(argv[i], "writeImages")) {
             write_images = true;
+        } else if (is_arg(argv[i], "budget") && i+1 < argc) {
+            timer.fBudgetMS = atof(argv[++i]);
+        } else if (is_arg(argv[i], "samples") && i+1 < argc) {
+            timer.fSamples = std::max(atoi(argv[++i]), 1);
+        } else if (is_arg(argv[i], "pin") && i+1 < argc) {
+            int cpu = atoi(argv[++i]);
+            if (!pin_to_cpu(cpu)) {
+                printf("Could not pin to cpu %d, running unpinned\n", cpu);
+            }
+        } else if (is_arg(argv[i], "stats")) {
+            print_stats = true;
+        } else if (is_arg(argv[i], "perf")) {
+            use_perf = true;
+        } else if (is_arg(argv[i], "allocs")) {
+            track_allocs = true;
+        } else if (is_arg(argv[i], "scaling")) {
+            scaling = true;
+        } else if (is_arg(argv[i], "json") && i+1 < argc) {
+            jsonFile = argv[++i];
+        } else if (is_arg(argv[i], "csv") && i+1 < argc) {
+            csvFile = argv[++i];
+        } else if (is_arg(argv[i], "baseline") && i+1 < argc) {
+            baselineFile = argv[++i];
+        } else if (is_arg(argv[i], "threshold") && i+1 < argc) {
+            threshold = atof(argv[++i]) / 100;  // given in percent
+        } else if (is_arg(argv[i], "trace") && i+1 < argc) {
+            traceFile = argv[++i];
         } else {
             printf("Unknown arg %s\n", argv[i]);
             return -1;
@@ -129,7 +400,35 @@ int main_bench(int argc, const char* argv[]) {
         return -1;
     }
 
+    if (scaling) {
+        run_scaling(match, timer);
+        return 0;
+    }
+
+    std::vector<BenchResult> baseline;
+    if (baselineFile && !read_json(baselineFile, &baseline)) {
+        printf("FAILED TO READ BASELINE %s\n", baselineFile);
+        return -1;
+    }
+    const bool want_results = jsonFile || csvFile || baselineFile;
+
+    std::unique_ptr<PerfCounters> perf;
+    if (use_perf) {
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->isAvailable()) {
+            printf("hardware counters unavailable: %s; timing only\n", perf->error());
+            perf.reset();
+        }
+    }
+
+    if (track_allocs && !AllocTracker::TracksMalloc()) {
+        printf("only operator new is tracked on this platform, not malloc\n");
+    }
+    int allocating = 0;
+
     std::vector<double> durs;
+    std::vector<BenchResult> results;
+    std::vector<GBenchmark::Factory> ran;
     double quotient = 0;
     for (int i = 0; i < count; ++i) {
         std::unique_ptr<GBenchmark> bench(gBenchFactories[i]());
@@ -139,8 +438,13 @@ int main_bench(int argc, const char* argv[]) {
             continue;
         }
 
+        ran.push_back(gBenchFactories[i]);
+        if (track_allocs) {
+            reset_peak_rss();
+        }
         GBitmap testBM;
-        double dur = handle_proc(bench.get(), name, &testBM, mode);
+        BenchStats stats = handle_proc(bench.get(), name, &testBM, mode, timer);
+        double dur = stats.fMedian;
         if (chatty_mode) {
             printf("%s %g", name, dur);
         }
@@ -152,9 +456,29 @@ int main_bench(int argc, const char* argv[]) {
             quotient += quo;
         }
         if (chatty_mode) {
-            printf("\n");
+            double cv = stats.fMean > 0 ? 100 * stats.fStdDev / stats.fMean : 0;
+            printf("  (min %g p90 %g stddev %.1f%% %dx%d)\n", stats.fMin, stats.fP90, cv,
+                   stats.fSamples, stats.fItersPerSample);
         }
         durs.push_back(dur);
+        if (perf && testBM.pixels()) {
+            print_bench_perf(bench.get(), testBM, stats.fItersPerSample, perf.get());
+        }
+        if (track_allocs && testBM.pixels() &&
+            print_bench_allocs(bench.get(), testBM, stats.fItersPerSample)) {
+            allocating += 1;
+        }
+        if (print_stats) {
+            print_bench_stats(gBenchFactories[i]);
+        }
+        if (want_results) {
+            BenchResult result;
+            result.fName = name;
+            result.fSize = bench->size();
+            result.fStats = stats;
+            result.fChecksum = checksum_bench(gBenchFactories[i]);
+            results.push_back(result);
+        }
 
         if (write_images) {
             std::string str(name);
@@ -191,5 +515,29 @@ int main_bench(int argc, const char* argv[]) {
             return -1;
         }
     }
-    return 0;
+
+    if (traceFile && !trace_benches(ran, traceFile)) {
+        printf("FAILED TO WRITE TO %s\n", traceFile);
+        return -1;
+    }
+    if (jsonFile && !write_json(jsonFile, results)) {
+        printf("FAILED TO WRITE TO %s\n", jsonFile);
+        return -1;
+    }
+    if (csvFile && !write_csv(csvFile, results)) {
+        printf("FAILED TO WRITE TO %s\n", csvFile);
+        return -1;
+    }
+    if (allocating > 0) {
+        printf("%d bench(es) allocate in their draw loop\n", allocating);
+    }
+    if (baselineFile) {
+        printf("compared to %s (threshold %g%%):\n", baselineFile, threshold * 100);
+        int failures = compare_to_baseline(results, baseline, threshold, match);
+        if (failures > 0) {
+            printf("%d bench(es) regressed, changed their output, or are missing\n", failures);
+            return 1;
+        }
+    }
+    return allocating > 0 ? 1 : 0;
 }
@@ -6,6 +6,9 @@
 #define _bench_h_DEFINED
 
 #include "../include/GPoint.h"
+#include <functional>
+#include <string>
+#include <vector>
 
 class GCanvas;
 
@@ -25,4 +28,19 @@ public:
  */
 extern const GBenchmark::Factory gBenchFactories[];
 
+/*
+ *  One point of the scaling matrix (bench --scaling): a bench that varies a single parameter
+ *  along fAxis. Benches on a 2D axis (e.g. shader x blend mode) also have a column.
+ */
+struct GScalingBench {
+    std::string fAxis;
+    std::string fRow;
+    std::string fColumn;                        // empty on 1D axes
+    const char* fUnit;                          // what fUnits counts, e.g. "px" or "edge"
+    double      fUnits;                         // processed by each draw
+    std::function<GBenchmark*()> fFactory;
+};
+
+void GetScalingBenches(std::vector<GScalingBench>*);
+
 #endif
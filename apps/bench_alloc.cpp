@@ -0,0 +1,150 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "bench_alloc.h"
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static std::atomic<bool>     gTracking{false};
+static std::atomic<uint64_t> gCount{0};
+static std::atomic<uint64_t> gBytes{0};
+
+static inline void note_alloc(size_t bytes) {
+    if (gTracking.load(std::memory_order_relaxed)) {
+        gCount.fetch_add(1, std::memory_order_relaxed);
+        gBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void AllocTracker::SetEnabled(bool enabled) {
+    gTracking.store(enabled, std::memory_order_relaxed);
+}
+
+AllocCounts AllocTracker::Counts() {
+    AllocCounts counts;
+    counts.fCount = gCount.load(std::memory_order_relaxed);
+    counts.fBytes = gBytes.load(std::memory_order_relaxed);
+    return counts;
+}
+
+#ifdef __GLIBC__
+
+/*
+ *  Definitions in the executable take precedence over libc's, for libstdc++ and every other
+ *  shared library too. glibc exports its allocator under __libc_ names to forward to. free() is
+ *  left alone, these all hand out memory from the same heap.
+ */
+extern "C" {
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+
+    void* malloc(size_t size) {
+        note_alloc(size);
+        return __libc_malloc(size);
+    }
+    void* calloc(size_t count, size_t size) {
+        note_alloc(count * size);
+        return __libc_calloc(count, size);
+    }
+    void* realloc(void* ptr, size_t size) {
+        note_alloc(size);
+        return __libc_realloc(ptr, size);
+    }
+    void* memalign(size_t alignment, size_t size) {
+        note_alloc(size);
+        return __libc_memalign(alignment, size);
+    }
+    void* aligned_alloc(size_t alignment, size_t size) {
+        note_alloc(size);
+        return __libc_memalign(alignment, size);
+    }
+    int posix_memalign(void** ptr, size_t alignment, size_t size) {
+        if (alignment < sizeof(void*) || (alignment & (alignment - 1))) {
+            return EINVAL;
+        }
+        note_alloc(size);
+        void* p = __libc_memalign(alignment, size);
+        if (!p) {
+            return ENOMEM;
+        }
+        *ptr = p;
+        return 0;
+    }
+}
+
+bool AllocTracker::TracksMalloc() { return true; }
+
+static inline void note_new(size_t) {}  // counted by malloc
+
+#else
+
+bool AllocTracker::TracksMalloc() { return false; }
+
+static inline void note_new(size_t size) { note_alloc(size); }
+
+#endif
+
+static void* tracked_new(size_t size) {
+    note_new(size);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return tracked_new(size); }
+void* operator new[](size_t size) { return tracked_new(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+bool reset_peak_rss() {
+#ifdef __linux__
+    // "5" resets the peak RSS (VmHWM) to the current RSS
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = fputs("5", f) >= 0;
+    return (fclose(f) == 0) && ok;
+#else
+    return false;
+#endif
+}
+
+int64_t peak_rss_kb() {
+#ifdef __linux__
+    // VmHWM honors reset_peak_rss(), getrusage's max RSS does not
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[256];
+        long long kb = -1;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "VmHWM: %lld kB", &kb) == 1) {
+                break;
+            }
+        }
+        fclose(f);
+        if (kb >= 0) {
+            return kb;
+        }
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes
+#else
+    return usage.ru_maxrss;         // KB
+#endif
+}
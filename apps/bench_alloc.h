@@ -0,0 +1,43 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef _bench_alloc_h_DEFINED
+#define _bench_alloc_h_DEFINED
+
+#include <stdint.h>
+
+/*
+ *  Heap allocation counting for bench. Linking bench_alloc.cpp replaces the global operator new
+ *  and delete and, with glibc, malloc and friends, so allocations made by the library (e.g. a
+ *  std::vector) and by C code are both seen. Nothing is counted until tracking is turned on.
+ */
+struct AllocCounts {
+    uint64_t fCount = 0;    // calls to malloc, calloc, realloc, operator new, ...
+    uint64_t fBytes = 0;    // bytes requested by those calls
+};
+
+class AllocTracker {
+public:
+    static void SetEnabled(bool enabled);
+
+    // totals over every period tracking has been enabled, on any thread
+    static AllocCounts Counts();
+
+    // false where only operator new is replaced, so plain malloc() calls go unseen
+    static bool TracksMalloc();
+};
+
+/*
+ *  Forget the process's peak resident set size so far, where the OS allows it (Linux's
+ *  /proc/self/clear_refs). Return true on success.
+ */
+bool reset_peak_rss();
+
+/*
+ *  The process's peak resident set size in KB, since start or the last reset_peak_rss(); -1 if
+ *  unknown.
+ */
+int64_t peak_rss_kb();
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "bench_perf.h"
+#include <string.h>
+
+#ifdef __linux__
+    #include <errno.h>
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+const char* PerfCounters::Name(int counter) {
+    static const char* gNames[kCount] = {
+        "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses",
+    };
+    return gNames[counter];
+}
+
+#ifdef __linux__
+
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static constexpr uint64_t cache_config(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+PerfCounters::PerfCounters() {
+    const struct { uint32_t type; uint64_t config; } events[kCount] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D) },
+        { PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL) },
+    };
+
+    int firstErrno = 0;
+    for (int i = 0; i < kCount; ++i) {
+        fFDs[i] = open_counter(events[i].type, events[i].config);
+        fValues[i] = -1;
+        if (fFDs[i] < 0 && !firstErrno) {
+            firstErrno = errno;
+        }
+    }
+    if (!this->isAvailable()) {
+        fError = firstErrno == EACCES || firstErrno == EPERM
+               ? "not permitted (see /proc/sys/kernel/perf_event_paranoid)"
+               : strerror(firstErrno);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fFDs) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::isAvailable() const {
+    for (int fd : fFDs) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::start() {
+    for (int fd : fFDs) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop() {
+    for (int i = 0; i < kCount; ++i) {
+        if (fFDs[i] >= 0) {
+            ioctl(fFDs[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < kCount; ++i) {
+        uint64_t data[3];    // value, time enabled, time running
+        fValues[i] = -1;
+        if (fFDs[i] >= 0 && read(fFDs[i], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+            fValues[i] = (int64_t)(data[0] * ((double)data[1] / data[2]));
+        }
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < kCount; ++i) {
+        fFDs[i] = -1;
+        fValues[i] = -1;
+    }
+    fError = "only supported on Linux";
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::isAvailable() const { return false; }
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+#endif
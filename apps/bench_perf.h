@@ -0,0 +1,50 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef _bench_perf_h_DEFINED
+#define _bench_perf_h_DEFINED
+
+#include <stdint.h>
+
+/*
+ *  Hardware performance counters for the calling thread, via perf_event_open on Linux.
+ *
+ *  Each counter is opened on its own, so a kernel or cpu that refuses one (e.g. no LLC event in
+ *  a VM) still reports the others. Where the kernel forbids counters entirely (see
+ *  /proc/sys/kernel/perf_event_paranoid) or on other platforms, isAvailable() is false and
+ *  start()/stop() do nothing.
+ */
+class PerfCounters {
+public:
+    enum Counter {
+        kCycles,
+        kInstructions,
+        kBranchMisses,
+        kL1DMisses,
+        kLLCMisses,
+    };
+    static constexpr int kCount = 5;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    bool isAvailable() const;
+    // why the counters could not be opened, when they are not available
+    const char* error() const { return fError; }
+
+    static const char* Name(int counter);
+
+    void start();
+    void stop();
+
+    // counter value since start(), scaled up if the kernel multiplexed it; -1 if not opened
+    int64_t value(int counter) const { return fValues[counter]; }
+
+private:
+    int         fFDs[kCount];
+    int64_t     fValues[kCount];
+    const char* fError = nullptr;
+};
+
+#endif
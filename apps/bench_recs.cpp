@@ -6,6 +6,7 @@
 #include "../include/GCanvas.h"
 #include "../include/GBitmap.h"
 #include "../include/GColor.h"
+#include "../include/GColorFilter.h"
 #include "../include/GRandom.h"
 #include "../include/GRect.h"
 #include <string>
@@ -15,6 +16,10 @@
 #include "bench_pa3.inc"
 #include "bench_pa4.inc"
 #include "bench_pa5.inc"
+#include "bench_io.inc"
+#include "bench_sampling.inc"
+#include "bench_scenes.inc"
+#include "bench_scaling.inc"
 
 const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* { return new RectsBench(false); },
@@ -48,10 +53,52 @@ const GBenchmark::Factory gBenchFactories[] {
         const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
         return new GradientBench(colors, 2, "gradient_2");
     },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new AxisGradientBench(colors, 2, "gradient_2_horizontal", false);
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new AxisGradientBench(colors, 2, "gradient_2_vertical", true);
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new RadialGradientBench(colors, 2, "radial_gradient_2");
+    },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }, { 1, 0, 0, 1 }};
+        return new SweepGradientBench(colors, 3, "sweep_gradient_3");
+    },
+    []() -> GBenchmark* { return new ComposeBench("apps/spock.png", "compose_bitmap_mask"); },
+    []() -> GBenchmark* {
+        return new ColorFilterBench("apps/spock.png", GColorFilter::Scale(1, 0.8f, 0.6f, 1),
+                                    "bitmap_tint");
+    },
+    []() -> GBenchmark* {
+        const float gray[20] = {
+            0.2126f, 0.7152f, 0.0722f, 0, 0,
+            0.2126f, 0.7152f, 0.0722f, 0, 0,
+            0.2126f, 0.7152f, 0.0722f, 0, 0,
+            0,       0,       0,       1, 0,
+        };
+        return new ColorFilterBench("apps/spock.png", GColorFilter(gray), "bitmap_desaturate");
+    },
     []() -> GBenchmark* {
         const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }, {0, 1, 0, 0}};
         return new GradientBench(colors, 3, "gradient_3");
     },
+    []() -> GBenchmark* {
+        // unevenly spaced, with a hard edge every few stops
+        constexpr int N = 24;
+        GColor colors[N];
+        float pos[N];
+        GRandom rand;
+        for (int i = 0; i < N; ++i) {
+            colors[i] = {rand.nextF(), rand.nextF(), rand.nextF(), 1};
+            pos[i] = i % 4 == 3 ? pos[i - 1] : (i + rand.nextF()) / N;
+        }
+        return new GradientBench(colors, N, "gradient_24_stops", GShader::kClamp, pos);
+    },
     []() -> GBenchmark* { return new PathBench("path_small", 0.1f, false); },
     []() -> GBenchmark* { return new PathBench("path_big",   1.0f, false); },
     []() -> GBenchmark* { return new PathBench("path_bigc",  1.0f,  true); },
@@ -71,10 +118,109 @@ const GBenchmark::Factory gBenchFactories[] {
         const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
         return new GradientBench(colors, 2, "gradient_2_mirror", GShader::kMirror);
     },
+    []() -> GBenchmark* {
+        const GColor colors[] = {{ 1, 0, 0, 1 }, { 0, 1, 1, 1 }};
+        return new RadialGradientBench(colors, 2, "radial_gradient_2_repeat", GShader::kRepeat);
+    },
     []() -> GBenchmark* { return new BitmapBench("apps/spock.png", "bitmap_repeat",
                                                  GShader::kRepeat); },
     []() -> GBenchmark* { return new BitmapBench("apps/spock.png", "bitmap_mirror",
                                                  GShader::kMirror); },
 
+    // bitmap sampling
+    []() -> GBenchmark* { return new ScaledBitmapBench(50, 4, "bitmap_up4"); },
+    []() -> GBenchmark* {
+        return new ScaledBitmapBench(50, 4, "bitmap_up4_linear", GShader::kLinear_FilterMode);
+    },
+    []() -> GBenchmark* { return new ScaledBitmapBench(1600, 0.125f, "bitmap_down8"); },
+    []() -> GBenchmark* {
+        return new ScaledBitmapBench(1600, 0.125f, "bitmap_down8_mip",
+                                     GShader::kNearest_FilterMode, GShader::kNearest_MipmapMode);
+    },
+    []() -> GBenchmark* {
+        return new ScaledBitmapBench(1600, 0.125f, "bitmap_down8_mip_linear",
+                                     GShader::kLinear_FilterMode, GShader::kNearest_MipmapMode);
+    },
+
+    // image io
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kRead, ImageIOBench::kPNG,
+                                "io_png_read");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kRead, ImageIOBench::kQOI,
+                                "io_qoi_read");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kRead, ImageIOBench::kRaw,
+                                "io_raw_read");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kMap, ImageIOBench::kRaw,
+                                "io_raw_map");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kWrite, ImageIOBench::kPNG,
+                                "io_png_write");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kWrite, ImageIOBench::kQOI,
+                                "io_qoi_write");
+    },
+    []() -> GBenchmark* {
+        return new ImageIOBench("apps/spock.png", ImageIOBench::kWrite, ImageIOBench::kRaw,
+                                "io_raw_write");
+    },
+    []() -> GBenchmark* {
+        return new PixelConvertBench(PixelConvertBench::kToRGBA, false, "convert_unpremul");
+    },
+    []() -> GBenchmark* {
+        return new PixelConvertBench(PixelConvertBench::kToRGBA, true, "convert_unpremul_scalar");
+    },
+    []() -> GBenchmark* {
+        return new PixelConvertBench(PixelConvertBench::kFromRGBA, false, "convert_premul");
+    },
+    []() -> GBenchmark* {
+        return new PixelConvertBench(PixelConvertBench::kFromRGBA, true, "convert_premul_scalar");
+    },
+
+    // real scenes, at 1x, 4x and 16x area
+    []() -> GBenchmark* {
+        return new SceneBench(draw_lion, 512, 512, "lion", 1);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_lion, 512, 512, "lion", 2);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_lion, 512, 512, "lion", 4);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_clock_bm, 480, 480, "spock_clock", 1);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_clock_bm, 480, 480, "spock_clock", 2);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_clock_bm, 480, 480, "spock_clock", 4);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_bm_tiling, 512, 512, "bitmap_tiling", 1);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_bm_tiling, 512, 512, "bitmap_tiling", 2);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_bm_tiling, 512, 512, "bitmap_tiling", 4);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_gradient_blendmodes, 450, 340, "gradient_blendmodes", 1);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_gradient_blendmodes, 450, 340, "gradient_blendmodes", 2);
+    },
+    []() -> GBenchmark* {
+        return new SceneBench(draw_gradient_blendmodes, 450, 340, "gradient_blendmodes", 4);
+    },
+
     nullptr,
 };
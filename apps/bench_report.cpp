@@ -0,0 +1,176 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "bench_report.h"
+#include "../include/GBitmap.h"
+#include <inttypes.h>
+#include <map>
+#include <set>
+#include <string.h>
+
+uint64_t checksum_bitmap(const GBitmap& bm) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int y = 0; y < bm.height(); ++y) {
+        const uint8_t* row = (const uint8_t*)bm.getAddr(0, y);
+        for (size_t i = 0; i < bm.width() * sizeof(GPixel); ++i) {
+            hash = (hash ^ row[i]) * 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+bool write_json(const char path[], const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        const BenchStats& s = r.fStats;
+        fprintf(f, "  {\"name\": \"%s\", \"width\": %d, \"height\": %d, "
+                   "\"median_ms\": %.6g, \"min_ms\": %.6g, \"p90_ms\": %.6g, "
+                   "\"mean_ms\": %.6g, \"stddev_ms\": %.6g, \"samples\": %d, \"iters\": %d, "
+                   "\"pixels_per_sec\": %.6g, \"checksum\": \"%016" PRIx64 "\"}%s\n",
+                r.fName.c_str(), r.fSize.width, r.fSize.height,
+                s.fMedian, s.fMin, s.fP90, s.fMean, s.fStdDev, s.fSamples, s.fItersPerSample,
+                r.pixelsPerSec(), r.fChecksum, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "]\n");
+    return fclose(f) == 0;
+}
+
+bool write_csv(const char path[], const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "name,width,height,median_ms,min_ms,p90_ms,mean_ms,stddev_ms,samples,iters,"
+               "pixels_per_sec,checksum\n");
+    for (const BenchResult& r : results) {
+        const BenchStats& s = r.fStats;
+        fprintf(f, "%s,%d,%d,%.6g,%.6g,%.6g,%.6g,%.6g,%d,%d,%.6g,%016" PRIx64 "\n",
+                r.fName.c_str(), r.fSize.width, r.fSize.height,
+                s.fMedian, s.fMin, s.fP90, s.fMean, s.fStdDev, s.fSamples, s.fItersPerSample,
+                r.pixelsPerSec(), r.fChecksum);
+    }
+    return fclose(f) == 0;
+}
+
+/*
+ *  Find "key": in line and return a pointer to its value (past any opening quote).
+ */
+static const char* find_value(const std::string& line, const char key[]) {
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return nullptr;
+    }
+    const char* value = line.c_str() + pos + pattern.size();
+    return *value == '"' ? value + 1 : value;
+}
+
+bool read_json(const char path[], std::vector<BenchResult>* results) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+
+    char buffer[1024];
+    while (fgets(buffer, sizeof(buffer), f)) {
+        std::string line(buffer);
+        const char* name = find_value(line, "name");
+        if (!name) {
+            continue;
+        }
+
+        BenchResult r;
+        r.fName.assign(name, strcspn(name, "\""));
+        auto number = [&](const char key[]) {
+            const char* v = find_value(line, key);
+            return v ? atof(v) : 0.0;
+        };
+        r.fSize = { (int)number("width"), (int)number("height") };
+        r.fStats.fMedian = number("median_ms");
+        r.fStats.fMin = number("min_ms");
+        r.fStats.fP90 = number("p90_ms");
+        r.fStats.fMean = number("mean_ms");
+        r.fStats.fStdDev = number("stddev_ms");
+        r.fStats.fSamples = (int)number("samples");
+        r.fStats.fItersPerSample = (int)number("iters");
+        if (const char* sum = find_value(line, "checksum")) {
+            r.fChecksum = strtoull(sum, nullptr, 16);
+        }
+        results->push_back(r);
+    }
+    fclose(f);
+    return true;
+}
+
+int compare_to_baseline(const std::vector<BenchResult>& results,
+                        const std::vector<BenchResult>& baseline, double threshold,
+                        const char* match) {
+    std::map<std::string, const BenchResult*> byName;
+    for (const BenchResult& b : baseline) {
+        byName[b.fName] = &b;
+    }
+
+    int failures = 0;
+    for (const BenchResult& r : results) {
+        auto iter = byName.find(r.fName);
+        if (iter == byName.end()) {
+            printf("  %-28s new\n", r.fName.c_str());
+            continue;
+        }
+        const BenchResult& b = *iter->second;
+
+        const char* verdict = "ok";
+        if (b.fChecksum != r.fChecksum) {
+            verdict = "CHANGED (checksum)";
+            failures += 1;
+        }
+
+        double delta = b.fStats.fMedian > 0 ? r.fStats.fMedian / b.fStats.fMedian - 1 : 0;
+        // 3 standard errors of the difference of the two medians, relative to the baseline
+        auto std_err = [](const BenchStats& s) {
+            return s.fSamples > 0 ? 1.2533 * s.fStdDev / sqrt(s.fSamples) : 0;
+        };
+        double se_b = std_err(b.fStats), se_r = std_err(r.fStats);
+        double noise = b.fStats.fMedian > 0
+                     ? 3 * sqrt(se_b * se_b + se_r * se_r) / b.fStats.fMedian : 0;
+        double limit = std::max(threshold, noise);
+        if (delta > limit) {
+            if (b.fChecksum == r.fChecksum) {
+                verdict = "REGRESSED";
+                failures += 1;
+            }
+        } else if (delta < -limit && b.fChecksum == r.fChecksum) {
+            verdict = "improved";
+        }
+        printf("  %-28s %10.4g -> %-10.4g %+6.1f%% (noise %.1f%%) %s\n", r.fName.c_str(),
+               b.fStats.fMedian, r.fStats.fMedian, delta * 100, noise * 100, verdict);
+    }
+
+    // what the baseline has that this run doesn't: only --match may leave a bench out
+    std::set<std::string> ran;
+    for (const BenchResult& r : results) {
+        ran.insert(r.fName);
+    }
+    int filtered = 0;
+    for (const BenchResult& b : baseline) {
+        if (ran.count(b.fName)) {
+            continue;
+        }
+        if (match && !strstr(b.fName.c_str(), match)) {
+            filtered += 1;
+            continue;
+        }
+        printf("  %-28s %10.4g -> none       MISSING\n", b.fName.c_str(), b.fStats.fMedian);
+        failures += 1;
+    }
+    if (filtered > 0) {
+        printf("  (%d baseline bench(es) not matching \"%s\" skipped)\n", filtered, match);
+    }
+    return failures;
+}
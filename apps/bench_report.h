@@ -0,0 +1,54 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef _bench_report_h_DEFINED
+#define _bench_report_h_DEFINED
+
+#include "bench_timer.h"
+#include "../include/GPoint.h"
+#include <string>
+#include <vector>
+
+class GBitmap;
+
+struct BenchResult {
+    std::string fName;
+    GISize      fSize = {0, 0};
+    BenchStats  fStats;
+    uint64_t    fChecksum = 0;    // of the bitmap after a single draw
+
+    // device pixels per second, counting the bench's whole canvas once per draw
+    double pixelsPerSec() const {
+        return fStats.fMedian > 0 ? fSize.width * fSize.height * 1000.0 / fStats.fMedian : 0;
+    }
+};
+
+/*
+ *  64 bit FNV-1a of the visible pixels (row padding is ignored).
+ */
+uint64_t checksum_bitmap(const GBitmap&);
+
+/*
+ *  Write the results as a JSON array (one bench object per line) or as CSV with a header row.
+ *  Return true on success.
+ */
+bool write_json(const char path[], const std::vector<BenchResult>&);
+bool write_csv(const char path[], const std::vector<BenchResult>&);
+
+/*
+ *  Read back a file written by write_json(). Return false if it could not be opened.
+ */
+bool read_json(const char path[], std::vector<BenchResult>*);
+
+/*
+ *  Print how each result compares with the baseline result of the same name, and return the
+ *  number of failures: benches whose checksum changed, or whose median slowed down by more than
+ *  both the threshold (a fraction, e.g. 0.05) and 3 standard errors of the two medians. A bench
+ *  in the baseline with no result is a failure too, unless match (if not null) filtered it out.
+ */
+int compare_to_baseline(const std::vector<BenchResult>& results,
+                        const std::vector<BenchResult>& baseline, double threshold,
+                        const char* match);
+
+#endif
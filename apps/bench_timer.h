@@ -0,0 +1,120 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef _bench_timer_h_DEFINED
+#define _bench_timer_h_DEFINED
+
+#include "../include/GTime.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+    #include <sched.h>
+#endif
+
+/*
+ *  Statistics over the per-iteration time (in milliseconds) of each sample.
+ */
+struct BenchStats {
+    double fMin = 0;
+    double fMedian = 0;
+    double fP90 = 0;
+    double fMean = 0;
+    double fStdDev = 0;
+    int    fSamples = 0;
+    int    fItersPerSample = 0;
+
+    static BenchStats Compute(std::vector<double> samples, int itersPerSample) {
+        BenchStats stats;
+        stats.fSamples = (int)samples.size();
+        stats.fItersPerSample = itersPerSample;
+        if (samples.empty()) {
+            return stats;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+        stats.fMin = samples[0];
+        stats.fMedian = (n & 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+        stats.fP90 = samples[std::min(n - 1, (size_t)ceil(n * 0.9) - 1)];
+
+        double sum = 0;
+        for (double s : samples) {
+            sum += s;
+        }
+        stats.fMean = sum / n;
+
+        double var = 0;
+        for (double s : samples) {
+            var += (s - stats.fMean) * (s - stats.fMean);
+        }
+        stats.fStdDev = n > 1 ? sqrt(var / (n - 1)) : 0;
+        return stats;
+    }
+};
+
+struct BenchTimerOptions {
+    double fWarmupMS = 20;      // run (at least once) for this long before measuring
+    double fBudgetMS = 250;     // total measuring time, split evenly between the samples
+    int    fSamples = 10;
+    int    fMaxIters = 1 << 20; // per sample
+};
+
+/*
+ *  Time body() over several samples. The number of iterations per sample is calibrated so that
+ *  each sample takes about budget / samples, which keeps the clock's resolution and the
+ *  per-sample overhead out of the result even for very fast benches.
+ */
+template <typename Body> BenchStats time_bench(Body&& body, const BenchTimerOptions& opts) {
+    auto run = [&](int iters) {
+        GNSec start = GTime::GetNSec();
+        for (int i = 0; i < iters; ++i) {
+            body();
+        }
+        return (GTime::GetNSec() - start) * 1e-6;
+    };
+
+    // warm up caches, page in the destination, let the cpu clock up
+    double warm = 0;
+    int iters = 1;
+    do {
+        double ms = run(iters);
+        warm += ms;
+        if (ms * 8 < opts.fWarmupMS && iters < opts.fMaxIters) {
+            iters *= 2;
+        }
+    } while (warm < opts.fWarmupMS);
+
+    // calibrate: grow until one sample fills its share of the budget
+    const double target = opts.fBudgetMS / std::max(opts.fSamples, 1);
+    double ms;
+    iters = 1;
+    while ((ms = run(iters)) < target && iters < opts.fMaxIters) {
+        int scaled = ms > 0 ? (int)std::min(target / ms * iters * 1.1, (double)opts.fMaxIters)
+                            : iters * 16;
+        iters = std::max(iters * 2, std::min(scaled, opts.fMaxIters));
+    }
+
+    std::vector<double> samples;
+    for (int i = 0; i < opts.fSamples; ++i) {
+        samples.push_back(run(iters) / iters);
+    }
+    return BenchStats::Compute(std::move(samples), iters);
+}
+
+/*
+ *  Restrict this thread to one cpu. Return false where that is not supported.
+ */
+static inline bool pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+#include <string>
+
+static bool has_suffix(const std::string& str, const char suffix[]) {
+    size_t n = strlen(suffix);
+    return str.size() >= n && !strcasecmp(str.c_str() + str.size() - n, suffix);
+}
+
+static bool write_bitmap(const GBitmap& bm, const std::string& path) {
+    if (has_suffix(path, ".gbm")) {
+        return bm.writeToRawFile(path.c_str());
+    }
+    if (has_suffix(path, ".qoi")) {
+        return bm.writeToQOIFile(path.c_str());
+    }
+    if (has_suffix(path, ".png")) {
+        return bm.writeToFile(path.c_str());
+    }
+    printf("unknown output format for %s (expected .png, .qoi or .gbm)\n", path.c_str());
+    return false;
+}
+
+/*
+ *  convert src dst [src dst ...]
+ *
+ *  Reads each src (png, qoi or raw, detected from the file) and writes it to dst, choosing the
+ *  format from dst's extension. e.g. to skip decoding the test assets on every run:
+ *
+ *      convert apps/spock.png apps/spock.gbm apps/wheel.png apps/wheel.gbm
+ */
+int main_convert(int argc, const char* argv[]) {
+    if (argc < 3 || !(argc & 1)) {
+        printf("usage: convert src dst [src dst ...]\n");
+        printf("   dst format is chosen by extension: .png .qoi .gbm (raw, mappable)\n");
+        return -1;
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        GBitmap bm;
+        if (!bm.readFromFile(argv[i])) {
+            printf("failed to read %s\n", argv[i]);
+            return -1;
+        }
+        bool ok = write_bitmap(bm, argv[i + 1]);
+        free(bm.pixels());
+        if (!ok) {
+            printf("failed to write %s\n", argv[i + 1]);
+            return -1;
+        }
+        printf("%s -> %s [%d %d]\n", argv[i], argv[i + 1], bm.width(), bm.height());
+    }
+    return 0;
+}
@@ -44,6 +44,15 @@ static GRect make_from_pts(const GPoint& p0, const GPoint& p1) {
                        std::max(p0.x, p1.x), std::max(p0.y, p1.y));
 }
 
+static GRect join(const GRect& a, const GRect& b) {
+    return GRect::LTRB(std::min(a.left, b.left), std::min(a.top, b.top),
+                       std::max(a.right, b.right), std::max(a.bottom, b.bottom));
+}
+
+static GRect outset(const GRect& r, float d) {
+    return GRect::LTRB(r.left - d, r.top - d, r.right + d, r.bottom + d);
+}
+
 static bool contains(const GRect& rect, float x, float y) {
     return rect.left < x && x < rect.right && rect.top < y && y < rect.bottom;
 }
@@ -129,6 +138,19 @@ public:
     virtual ~Shape() {}
     virtual GRect getRect() = 0;
     virtual void setRect(const GRect&) {}
+
+    /**
+     *  Everything draw() and drawHilite() touch, as long as editing only moves the rect or the
+     *  shader's handles. Subclasses that draw outside of that must widen it.
+     */
+    virtual GRect getDirtyBounds() {
+        GRect r = this->getRect();
+        if (fShader) {
+            r = join(r, make_from_pts(fGradPts[0], fGradPts[1]));
+        }
+        // room for the corner and handle hilites
+        return outset(r, CORNER_SIZE + 2);
+    }
     virtual bool animates() const { return false; }
 
     GColor getColor() {
@@ -216,7 +238,8 @@ public:
                            * GMatrix::Scale((fGradPts[1].x - fGradPts[0].x) / gBM.width(),
                                             (fGradPts[1].y - fGradPts[0].y) / gBM.height());
 
-                fShader = GCreateBitmapShader(gBM, mx.inverseOrI(), fTileMode);
+                fShader = GCreateBitmapShader(gBM, mx.inverseOrI(), fTileMode,
+                                              GShader::kLinear_FilterMode);
             }
         }
     }
@@ -234,9 +257,10 @@ public:
                 }
                 if (index >= 0) {
                     return new GClick(p, [this, wind, index](GClick* click) {
+                        GRect before = this->getDirtyBounds();
                         fGradPts[index] = click->curr();
                         this->rebuildShader();
-                        wind->requestDraw();
+                        wind->requestDraw(join(before, this->getDirtyBounds()).roundOut());
                     });
                 }
             } break;
@@ -249,9 +273,10 @@ public:
                 }
                 if (index >= 0) {
                     return new GClick(p, [this, wind, index](GClick* click) {
+                        GRect before = this->getDirtyBounds();
                         fGradPts[index] = click->curr();
                         this->rebuildShader();
-                        wind->requestDraw();
+                        wind->requestDraw(join(before, this->getDirtyBounds()).roundOut());
                     });
                 }
             } break;
@@ -346,7 +371,8 @@ public:
             canvas->drawRect(fRect, paint);
         }
 #else
-        auto sh = GCreateBitmapShader(fBM, GMatrix());
+        auto sh = GCreateBitmapShader(fBM, GMatrix(), GShader::kClamp,
+                                      GShader::kLinear_FilterMode);
         paint.setShader(sh.get());
 
         canvas->save();
@@ -371,7 +397,7 @@ private:
 
 static void make_regular_poly(GPoint pts[], int count, float cx, float cy, float rx, float ry) {
     float angle = 0;
-    const float deltaAngle = M_PI * 2 / count;
+    const float deltaAngle = (float)(M_PI * 2 / count);
 
     for (int i = 0; i < count; ++i) {
         pts[i] = {cx + cos(angle) * rx, cy + sin(angle) * ry};
@@ -556,46 +582,64 @@ protected:
             GPoint anchor;
             if (in_resize_corner(fShape->getRect(), loc.x, loc.y, &anchor)) {
                 return new GClick(loc, [this, anchor](GClick* click) {
-                    fShape->setRect(make_from_pts(click->curr(), anchor));
+                    this->editShape([&] {
+                        fShape->setRect(make_from_pts(click->curr(), anchor));
+                    });
                     this->updateTitle();
-                    this->requestDraw();
                 });
             }
         }
 
         for (int i = fList.size() - 1; i >= 0; --i) {
             if (contains(fList[i]->getRect(), loc.x, loc.y)) {
-                fShape = fList[i];
+                this->selectShape(fList[i]);
                 this->updateTitle();
                 return new GClick(loc, [this](GClick* click) {
                     const GPoint curr = click->curr();
                     const GPoint prev = click->prev();
-                    fShape->offset(curr.x - prev.x, curr.y - prev.y);
+                    this->editShape([&] {
+                        fShape->offset(curr.x - prev.x, curr.y - prev.y);
+                    });
                     this->updateTitle();
-                    this->requestDraw();
                 });
             }
         }
         
         // else create a new shape
-        fShape = new RectShape(rand_color());
+        this->selectShape(new RectShape(rand_color()));
         fList.push_back(fShape);
         this->updateTitle();
         return new GClick(loc, [this](GClick* click) {
             if (fShape && GClick::kUp_State == click->state()) {
                 if (fShape->getRect().isEmpty()) {
                     this->removeShape(fShape);
-                    fShape = NULL;
+                    this->selectShape(nullptr);
                     return;
                 }
             }
-            fShape->setRect(make_from_pts(click->orig(), click->curr()));
+            this->editShape([&] {
+                fShape->setRect(make_from_pts(click->orig(), click->curr()));
+            });
             this->updateTitle();
-            this->requestDraw();
         });
     }
 
 private:
+    // Not every shape's hilite fits in its dirty bounds, so moving the selection redraws it all.
+    void selectShape(Shape* shape) {
+        if (shape != fShape) {
+            fShape = shape;
+            this->requestDraw();
+        }
+    }
+
+    // Apply an edit to the selected shape, and redraw just where it was and where it is now.
+    template <typename Edit> void editShape(Edit edit) {
+        GRect before = fShape->getDirtyBounds();
+        edit();
+        this->requestDraw(join(before, fShape->getDirtyBounds()).roundOut());
+    }
+
     void removeShape(Shape* target) {
         assert(target);
 
@@ -630,6 +674,6 @@ int main(int argc, char const* const* argv) {
 
     GWindow* wind = new TestWindow(640, 480);
 
-    return wind->run();
+    return wind->run(argc, argv);
 }
 
@@ -7,7 +7,7 @@
 template <typename DRAW> void spin(GCanvas* canvas, int N, DRAW draw) {
     for (int i = 0; i < N; ++i) {
         canvas->save();
-        canvas->rotate(2 * M_PI * i / N);
+        canvas->rotate((float)(2 * M_PI * i / N));
         draw(canvas);
         canvas->restore();
     }
@@ -53,6 +53,12 @@ public:
 
     GRect getRect() override { return fRect; }
 
+    GRect getDirtyBounds() override {
+        // the hilited control points of the oval's quads sit up to r/cos(pi/8) from its center
+        const float pad = std::max(fRect.width(), fRect.height()) * 0.05f;
+        return outset(this->Shape::getDirtyBounds(), pad);
+    }
+
     void setRect(const GRect& r) override { fRect = r; }
     GColor onGetColor() override { return fColor; }
     void onSetColor(const GColor& c) override { fColor = c; }
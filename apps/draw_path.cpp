@@ -58,7 +58,7 @@ static void set_rect_pts(GPoint pts[4], const GRect& r) {
 
 static void make_star(GPoint pts[], int count, float anglePhase) {
     assert(count & 1);
-    float da = 2 * M_PI * (count >> 1) / count;
+    float da = (float)(2 * M_PI * (count >> 1) / count);
     float angle = anglePhase;
     for (int i = 0; i < count; ++i) {
         pts[i].x = cosf(angle);
@@ -113,7 +113,7 @@ public:
         
         const double speed = 32;
         const float period = 48.5;
-        float phase = fmod(GTime::GetMSec() * speed / 1000.0, period);
+        float phase = (float)fmod(GTime::GetMSec() * speed / 1000.0, period);
 
         int base = 0;
         for (int j = 0; j < fCtrCount; ++j) {
@@ -0,0 +1,829 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+/*
+ *  Differential fuzzing of the fast raster pipeline against the reference backend (see
+ *  reference.h). Each iteration draws a random scene -- rects, convex polygons and paths, under
+ *  random matrices, with random colors, shaders and blend modes -- into one canvas of each kind,
+ *  and requires the pixels to match exactly. The shaders are bitmaps, linear, radial and sweep
+ *  gradients (with evenly spaced stops or random positions), and compose and modulate shaders
+ *  over those.
+ *
+ *  On the first mismatch the scene is shrunk to as few, as simple, ops as still mismatch, and
+ *  printed as canvas calls along with the first pixel that differs. Every scene is derived from
+ *  its seed alone, so "fuzz --seed N --iters 1" replays iteration N.
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GCanvasStats.h"
+#include "../include/GColorFilter.h"
+#include "../include/GMatrix.h"
+#include "../include/GPaint.h"
+#include "../include/GPath.h"
+#include "../include/GRandom.h"
+#include "../include/GShader.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct FuzzShader {
+    enum Kind {
+        kNone,
+        kBitmap,
+        kLinearGradient,
+        kRadialGradient,
+        kSweepGradient,
+        kCompose,
+        kModulate,
+    };
+    Kind fKind = kNone;
+    GShader::TileMode fTileMode = GShader::kClamp;     // not kSweepGradient
+    // kBitmap
+    GMatrix fLocalInverse;
+    GShader::FilterMode fFilterMode = GShader::kNearest_FilterMode;
+    GShader::MipmapMode fMipmapMode = GShader::kNone_MipmapMode;
+    // the gradients: kLinearGradient runs from fP0 to fP1, and the others are centered on fP0
+    GPoint fP0 = {0, 0}, fP1 = {0, 0};
+    float fRadius = 1;                  // kRadialGradient
+    float fStartRadians = 0;            // kSweepGradient
+    std::vector<GColor> fColors;
+    std::vector<float> fPos;            // one per color, or empty for evenly spaced stops
+    // kCompose draws fChildren[1] over fChildren[0] with fMode; kModulate scales fChildren[0]
+    std::vector<FuzzShader> fChildren;
+    GBlendMode fMode = GBlendMode::kSrcOver;
+    float fAlpha = 1;                   // kModulate
+};
+
+struct FuzzOp {
+    enum Kind {
+        kRect,
+        kConvexPolygon,
+        kPath,
+    };
+    Kind fKind = kRect;
+    GMatrix fMatrix;
+    GColor fColor = {0, 0, 0, 1};
+    GBlendMode fMode = GBlendMode::kSrcOver;
+    FuzzShader fShader;
+    std::vector<float> fColorMatrix;    // empty for no color filter
+    // kRect uses the first two as left/top and right/bottom, kConvexPolygon all of them in
+    // order, and kPath is a sequence of contours, each starting with a moveTo
+    std::vector<GPoint> fPts;
+    std::vector<GPath::Verb> fVerbs;    // kPath only
+};
+
+struct FuzzScene {
+    int fWidth, fHeight;
+    uint32_t fBackgroundSeed;   // 0 for a transparent background
+    std::vector<FuzzOp> fOps;
+};
+
+/*
+ *  A small bitmap for the bitmap shaders, with translucent texels so every blend path is hit.
+ */
+static GPixelBuffer make_texture(uint32_t seed) {
+    GRandom rand(seed);
+    GPixelBuffer buffer(rand.nextRange(1, 24), rand.nextRange(1, 24));
+    const GBitmap& bm = buffer.bitmap();
+    const bool opaque = rand.nextRange(0, 1);
+    visit_pixels(bm, [&](int, int, GPixel* p) {
+        unsigned a = opaque ? 0xFF : rand.nextRange(0, 0xFF);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+    GBitmap* writable = const_cast<GBitmap*>(&bm);
+    writable->setIsOpaque(opaque ? GBitmap::kYes_IsOpaque : GBitmap::kNo_IsOpaque);
+    return buffer;
+}
+
+static constexpr uint32_t kTextureSeed = 1234;
+
+class SceneGenerator {
+public:
+    explicit SceneGenerator(uint32_t seed) : fRand(seed * 2654435761u + 1) {}
+
+    FuzzScene make(int width, int height, int maxOps) {
+        FuzzScene scene = {width, height, this->chance(2) ? fRand.nextU() | 1 : 0, {}};
+        fW = (float) width;
+        fH = (float) height;
+        int count = fRand.nextRange(1, maxOps);
+        for (int i = 0; i < count; ++i) {
+            scene.fOps.push_back(this->makeOp());
+        }
+        return scene;
+    }
+
+private:
+    GRandom fRand;
+    float fW = 0, fH = 0;
+
+    bool chance(int oneIn) { return fRand.nextRange(1, oneIn) == 1; }
+
+    float range(float lo, float hi) { return lo + (hi - lo) * fRand.nextF(); }
+
+    /*
+     *  Mostly coordinates that reach past the device, so clipping is exercised, and often on
+     *  pixel centers and edges, where rounding decides coverage.
+     */
+    float coord(float extent) {
+        float v = this->range(-0.25f * extent, 1.25f * extent);
+        switch (fRand.nextRange(0, 3)) {
+            case 0: return GFloorToInt(v) + 0.5f;
+            case 1: return (float) GFloorToInt(v);
+            default: return v;
+        }
+    }
+
+    GPoint point() { return {this->coord(fW), this->coord(fH)}; }
+
+    GMatrix matrix() {
+        const float cx = fW * 0.5f, cy = fH * 0.5f;
+        switch (fRand.nextRange(0, 5)) {
+            case 0:
+                return GMatrix();
+            case 1:
+                return GMatrix::Translate(this->range(-fW, fW), this->range(-fH, fH));
+            case 2:
+                return GMatrix::Translate(cx, cy) *
+                       GMatrix::Scale(this->range(-3, 3), this->range(-3, 3)) *
+                       GMatrix::Translate(-cx, -cy);
+            case 3:
+                return GMatrix::Translate(cx, cy) * GMatrix::Rotate(this->range(0, 6.2832f)) *
+                       GMatrix::Translate(-cx, -cy);
+            case 4:
+                // axis aligned but for a small skew, near the unrotated rect fast path
+                return GMatrix(1, this->chance(2) ? 0 : this->range(-0.1f, 0.1f), 0,
+                               this->chance(2) ? 0 : this->range(-0.1f, 0.1f), 1, 0);
+            default:
+                return GMatrix(this->range(-2, 2), this->range(-2, 2), this->range(-fW, fW),
+                               this->range(-2, 2), this->range(-2, 2), this->range(-fH, fH));
+        }
+    }
+
+    GColor color() {
+        float a;
+        switch (fRand.nextRange(0, 3)) {
+            case 0:  a = 1; break;
+            case 1:  a = 0; break;
+            default: a = fRand.nextF(); break;
+        }
+        return {fRand.nextF(), fRand.nextF(), fRand.nextF(), a};
+    }
+
+    // a scale (the fast case) or a full matrix, sometimes pushing colors out of range
+    std::vector<float> colorMatrix() {
+        std::vector<float> m(20, 0.0f);
+        if (this->chance(2)) {
+            for (int i = 0; i < 4; ++i) {
+                m[i * 6] = fRand.nextF();
+            }
+        } else {
+            for (int i = 0; i < 20; ++i) {
+                m[i] = (i % 5 == 4) ? this->range(-0.5f, 0.5f) : this->range(-1, 2);
+            }
+        }
+        return m;
+    }
+
+    /*
+     *  Mostly in order, sometimes repeated (a hard edge), and sometimes out of order or past
+     *  [0, 1], which the gradients pin and make non-decreasing themselves.
+     */
+    void stops(FuzzShader* shader) {
+        for (int i = fRand.nextRange(1, 5); i > 0; --i) {
+            shader->fColors.push_back(this->color());
+        }
+        if (this->chance(2)) {
+            return;
+        }
+        for (size_t i = 0; i < shader->fColors.size(); ++i) {
+            shader->fPos.push_back(i && this->chance(4) ? shader->fPos.back()
+                                                        : this->range(-0.25f, 1.25f));
+        }
+        if (!this->chance(4)) {
+            std::sort(shader->fPos.begin(), shader->fPos.end());
+        }
+    }
+
+    // compose and modulate shaders nest, but only depth levels deep
+    FuzzShader shader(int depth = 2) {
+        FuzzShader shader;
+        switch (fRand.nextRange(0, depth > 0 ? 6 : 4)) {
+            case 0:
+                return shader;
+            case 1:
+                shader.fKind = FuzzShader::kBitmap;
+                shader.fLocalInverse = this->chance(3) ? GMatrix() : this->matrix();
+                shader.fFilterMode = (GShader::FilterMode) fRand.nextRange(0, 1);
+                shader.fMipmapMode = (GShader::MipmapMode) fRand.nextRange(0, 1);
+                break;
+            case 2:
+                shader.fKind = FuzzShader::kLinearGradient;
+                shader.fP0 = this->point();
+                shader.fP1 = this->chance(8) ? shader.fP0 : this->point();
+                this->stops(&shader);
+                break;
+            case 3:
+                shader.fKind = FuzzShader::kRadialGradient;
+                shader.fP0 = this->point();
+                // now and then wider than the color table, where the entries are blended
+                shader.fRadius = this->chance(8) ? this->range(0, 1) :
+                                 this->chance(4) ? this->range(fW, 20 * fW) : this->range(1, fW);
+                this->stops(&shader);
+                break;
+            case 4:
+                shader.fKind = FuzzShader::kSweepGradient;
+                shader.fP0 = this->point();
+                shader.fStartRadians = this->range(-6.2832f, 6.2832f);
+                this->stops(&shader);
+                break;
+            case 5:
+                shader.fKind = FuzzShader::kCompose;
+                shader.fChildren = {this->shader(depth - 1), this->shader(depth - 1)};
+                shader.fMode = (GBlendMode) fRand.nextRange(0, GCanvasStats::kBlendModeCount - 1);
+                break;
+            default:
+                shader.fKind = FuzzShader::kModulate;
+                shader.fChildren = {this->shader(depth - 1)};
+                shader.fAlpha = this->chance(4) ? 1.0f : fRand.nextF();
+                break;
+        }
+        shader.fTileMode = (GShader::TileMode) fRand.nextRange(0, 2);
+        return shader;
+    }
+
+    void convexPolygon(std::vector<GPoint>* pts) {
+        // points on an ellipse, in angle order
+        GPoint center = this->point();
+        float rx = this->range(1, fW), ry = this->range(1, fH);
+        int count = fRand.nextRange(3, 10);
+        std::vector<float> angles;
+        for (int i = 0; i < count; ++i) {
+            angles.push_back(this->range(0, 6.2832f));
+        }
+        std::sort(angles.begin(), angles.end());
+        for (float t : angles) {
+            pts->push_back({center.x + rx * cosf(t), center.y + ry * sinf(t)});
+        }
+    }
+
+    FuzzOp makeOp() {
+        FuzzOp op;
+        op.fKind = (FuzzOp::Kind) fRand.nextRange(0, 2);
+        op.fMatrix = this->chance(3) ? GMatrix() : this->matrix();
+        op.fColor = this->color();
+        op.fMode = (GBlendMode) fRand.nextRange(0, GCanvasStats::kBlendModeCount - 1);
+        op.fShader = this->shader();
+        if (this->chance(4)) {
+            op.fColorMatrix = this->colorMatrix();
+        }
+
+        switch (op.fKind) {
+            case FuzzOp::kRect:
+                op.fPts = {this->point(), this->point()};
+                break;
+            case FuzzOp::kConvexPolygon:
+                this->convexPolygon(&op.fPts);
+                break;
+            case FuzzOp::kPath:
+                for (int contour = fRand.nextRange(1, 3); contour > 0; --contour) {
+                    op.fVerbs.push_back(GPath::kMove);
+                    op.fPts.push_back(this->point());
+                    for (int seg = fRand.nextRange(2, 12); seg > 0; --seg) {
+                        int kind = fRand.nextRange(0, 5);
+                        GPath::Verb verb = kind == 4 ? GPath::kQuad :
+                                           kind == 5 ? GPath::kCubic : GPath::kLine;
+                        op.fVerbs.push_back(verb);
+                        int n = verb == GPath::kQuad ? 2 : verb == GPath::kCubic ? 3 : 1;
+                        for (int i = 0; i < n; ++i) {
+                            op.fPts.push_back(this->point());
+                        }
+                    }
+                }
+                break;
+        }
+        return op;
+    }
+};
+
+static int verb_points(GPath::Verb verb) {
+    switch (verb) {
+        case GPath::kQuad:  return 2;
+        case GPath::kCubic: return 3;
+        default:            return 1;
+    }
+}
+
+static GPath make_path(const FuzzOp& op) {
+    GPath path;
+    size_t p = 0;
+    for (GPath::Verb verb : op.fVerbs) {
+        const GPoint* pts = &op.fPts[p];
+        switch (verb) {
+            case GPath::kMove:  path.moveTo(pts[0]); break;
+            case GPath::kLine:  path.lineTo(pts[0]); break;
+            case GPath::kQuad:  path.quadTo(pts[0], pts[1]); break;
+            case GPath::kCubic: path.cubicTo(pts[0], pts[1], pts[2]); break;
+            default: break;
+        }
+        p += verb_points(verb);
+    }
+    return path;
+}
+
+/*
+ *  The shader spec describes, or nullptr for none. It and its children (which a compose or
+ *  modulate shader does not own) are kept alive in owned.
+ */
+static GShader* make_shader(const FuzzShader& spec, const GBitmap& texture,
+                            std::vector<std::unique_ptr<GShader>>* owned) {
+    std::vector<GShader*> children;
+    for (const FuzzShader& child : spec.fChildren) {
+        children.push_back(make_shader(child, texture, owned));
+    }
+    const float* pos = spec.fPos.empty() ? nullptr : spec.fPos.data();
+    const int count = (int) spec.fColors.size();
+
+    std::unique_ptr<GShader> shader;
+    switch (spec.fKind) {
+        case FuzzShader::kBitmap:
+            shader = GCreateBitmapShader(texture, spec.fLocalInverse, spec.fTileMode,
+                                         spec.fFilterMode, spec.fMipmapMode);
+            break;
+        case FuzzShader::kLinearGradient:
+            shader = GCreateLinearGradient(spec.fP0, spec.fP1, spec.fColors.data(), pos, count,
+                                           spec.fTileMode);
+            break;
+        case FuzzShader::kRadialGradient:
+            shader = GCreateRadialGradient(spec.fP0, spec.fRadius, spec.fColors.data(), pos,
+                                           count, spec.fTileMode);
+            break;
+        case FuzzShader::kSweepGradient:
+            shader = GCreateSweepGradient(spec.fP0, spec.fStartRadians, spec.fColors.data(), pos,
+                                          count);
+            break;
+        case FuzzShader::kCompose:
+            shader = GCreateComposeShader(children[0], children[1], spec.fMode);
+            break;
+        case FuzzShader::kModulate:
+            shader = GCreateModulateShader(children[0], spec.fAlpha);
+            break;
+        default:
+            break;
+    }
+    owned->push_back(std::move(shader));
+    return owned->back().get();
+}
+
+static void fill_background(const GBitmap& bm, uint32_t seed) {
+    GRandom rand(seed);
+    visit_pixels(bm, [&](int, int, GPixel* p) {
+        unsigned a = rand.nextRange(0, 3) == 0 ? 0xFF : rand.nextRange(0, 0xFF);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+}
+
+static GPixelBuffer render(const FuzzScene& scene, bool reference) {
+    GPixelBuffer pixels(scene.fWidth, scene.fHeight);
+    if (scene.fBackgroundSeed) {
+        fill_background(pixels.bitmap(), scene.fBackgroundSeed);
+    }
+    auto canvas = reference ? GCreateReferenceCanvas(pixels.bitmap())
+                            : GCreateCanvas(pixels.bitmap());
+    // each op gets its own shader, so no state (e.g. a mipmap) carries over between backends
+    GPixelBuffer texture = make_texture(kTextureSeed);
+
+    for (const FuzzOp& op : scene.fOps) {
+        std::vector<std::unique_ptr<GShader>> shaders;
+        GPaint paint(op.fColor);
+        paint.setBlendMode(op.fMode);
+        paint.setShader(make_shader(op.fShader, texture.bitmap(), &shaders));
+        std::unique_ptr<GColorFilter> filter;
+        if (!op.fColorMatrix.empty()) {
+            filter = std::make_unique<GColorFilter>(op.fColorMatrix.data());
+            paint.setColorFilter(filter.get());
+        }
+
+        canvas->save();
+        canvas->concat(op.fMatrix);
+        switch (op.fKind) {
+            case FuzzOp::kRect:
+                canvas->drawRect(GRect::LTRB(op.fPts[0].x, op.fPts[0].y,
+                                             op.fPts[1].x, op.fPts[1].y), paint);
+                break;
+            case FuzzOp::kConvexPolygon:
+                canvas->drawConvexPolygon(op.fPts.data(), (int) op.fPts.size(), paint);
+                break;
+            case FuzzOp::kPath:
+                canvas->drawPath(make_path(op), paint);
+                break;
+        }
+        canvas->restore();
+    }
+    return pixels;
+}
+
+struct Mismatch {
+    int fX = -1, fY = -1;
+    GPixel fFast = 0, fReference = 0;
+
+    bool found() const { return fX >= 0; }
+};
+
+static Mismatch compare(const FuzzScene& scene) {
+    GPixelBuffer fast = render(scene, false);
+    GPixelBuffer ref = render(scene, true);
+
+    Mismatch m;
+    for (int y = 0; y < scene.fHeight; ++y) {
+        const GPixel* a = fast->getAddr(0, y);
+        const GPixel* b = ref->getAddr(0, y);
+        for (int x = 0; x < scene.fWidth; ++x) {
+            if (a[x] != b[x]) {
+                m = {x, y, a[x], b[x]};
+                return m;
+            }
+        }
+    }
+    return m;
+}
+
+template <typename T> static bool assign(T* field, const T& value) {
+    if (!memcmp(field, &value, sizeof(T))) {
+        return false;
+    }
+    *field = value;
+    return true;
+}
+
+static bool hoist_child(FuzzShader* shader, size_t index) {
+    if (index >= shader->fChildren.size()) {
+        return false;
+    }
+    FuzzShader child = shader->fChildren[index];
+    *shader = std::move(child);
+    return true;
+}
+
+/*
+ *  Greedily shrink a mismatching scene: drop whole ops, then simplify what is left one
+ *  property at a time, keeping each change that still mismatches, until nothing more can go.
+ */
+static FuzzScene minimize(FuzzScene scene) {
+    auto still_fails = [](const FuzzScene& s) { return compare(s).found(); };
+    auto try_change = [&](FuzzScene candidate) {
+        if (still_fails(candidate)) {
+            scene = std::move(candidate);
+            return true;
+        }
+        return false;
+    };
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        for (size_t i = 0; i < scene.fOps.size() && scene.fOps.size() > 1; ) {
+            FuzzScene candidate = scene;
+            candidate.fOps.erase(candidate.fOps.begin() + i);
+            if (try_change(candidate)) {
+                progress = true;
+            } else {
+                ++i;
+            }
+        }
+
+        if (scene.fBackgroundSeed) {
+            FuzzScene candidate = scene;
+            candidate.fBackgroundSeed = 0;
+            progress |= try_change(candidate);
+        }
+
+        for (size_t i = 0; i < scene.fOps.size(); ++i) {
+            // each returns false when there was nothing to simplify; none may undo another, or
+            // this would never settle
+            std::vector<std::function<bool(FuzzOp*)>> simplifications = {
+                [](FuzzOp* op) { return assign(&op->fMatrix, GMatrix()); },
+                [](FuzzOp* op) { return assign(&op->fShader.fKind, FuzzShader::kNone); },
+                // a compose or modulate shader by one of its children
+                [](FuzzOp* op) { return hoist_child(&op->fShader, 0); },
+                [](FuzzOp* op) { return hoist_child(&op->fShader, 1); },
+                [](FuzzOp* op) {
+                    if (op->fColorMatrix.empty()) return false;
+                    op->fColorMatrix.clear();
+                    return true;
+                },
+                [](FuzzOp* op) { return assign(&op->fMode, GBlendMode::kSrcOver); },
+                [](FuzzOp* op) { return assign(&op->fColor.a, 1.0f); },
+                [](FuzzOp* op) { return assign(&op->fShader.fLocalInverse, GMatrix()); },
+                [](FuzzOp* op) {
+                    return assign(&op->fShader.fMipmapMode, GShader::kNone_MipmapMode);
+                },
+                [](FuzzOp* op) { return assign(&op->fShader.fTileMode, GShader::kClamp); },
+                [](FuzzOp* op) {
+                    if (op->fShader.fPos.empty()) return false;
+                    op->fShader.fPos.clear();
+                    return true;
+                },
+                [](FuzzOp* op) {
+                    if (op->fShader.fColors.size() <= 2) return false;
+                    op->fShader.fColors.resize(2);
+                    if (!op->fShader.fPos.empty()) {
+                        op->fShader.fPos.resize(2);
+                    }
+                    return true;
+                },
+            };
+            for (auto& simplify : simplifications) {
+                FuzzScene candidate = scene;
+                if (simplify(&candidate.fOps[i])) {
+                    progress |= try_change(candidate);
+                }
+            }
+
+            // drop polygon vertices, and path segments (a contour's moveTo goes last)
+            FuzzOp& op = scene.fOps[i];
+            if (op.fKind == FuzzOp::kConvexPolygon) {
+                for (size_t v = 0; v < scene.fOps[i].fPts.size() && scene.fOps[i].fPts.size() > 3; ) {
+                    FuzzScene candidate = scene;
+                    auto& pts = candidate.fOps[i].fPts;
+                    pts.erase(pts.begin() + v);
+                    if (try_change(candidate)) {
+                        progress = true;
+                    } else {
+                        ++v;
+                    }
+                }
+            } else if (op.fKind == FuzzOp::kPath) {
+                for (size_t v = scene.fOps[i].fVerbs.size(); v-- > 0; ) {
+                    const FuzzOp& cur = scene.fOps[i];
+                    if (cur.fVerbs[v] == GPath::kMove && v + 1 < cur.fVerbs.size() &&
+                        cur.fVerbs[v + 1] != GPath::kMove) {
+                        continue;   // still starts a contour
+                    }
+                    size_t first = 0;
+                    for (size_t k = 0; k < v; ++k) {
+                        first += verb_points(cur.fVerbs[k]);
+                    }
+                    FuzzScene candidate = scene;
+                    FuzzOp& c = candidate.fOps[i];
+                    c.fPts.erase(c.fPts.begin() + first,
+                                 c.fPts.begin() + first + verb_points(c.fVerbs[v]));
+                    c.fVerbs.erase(c.fVerbs.begin() + v);
+                    progress |= try_change(candidate);
+                }
+            }
+        }
+    }
+    return scene;
+}
+
+static void print_point(GPoint p) {
+    printf("{%.9g, %.9g}", p.x, p.y);
+}
+
+static void print_color(GColor c) {
+    printf("GColor::RGBA(%.9g, %.9g, %.9g, %.9g)", c.r, c.g, c.b, c.a);
+}
+
+static void print_matrix(const GMatrix& m) {
+    printf("GMatrix(%.9g, %.9g, %.9g, %.9g, %.9g, %.9g)", m[0], m[1], m[2], m[3], m[4], m[5]);
+}
+
+static const char* gTileNames[] = { "kClamp", "kRepeat", "kMirror" };
+static const char* gModeNames[] = {
+    "kClear", "kSrc", "kDst", "kSrcOver", "kDstOver", "kSrcIn",
+    "kDstIn", "kSrcOut", "kDstOut", "kSrcATop", "kDstATop", "kXor",
+};
+
+static bool uses_texture(const FuzzShader& s) {
+    if (s.fKind == FuzzShader::kBitmap) {
+        return true;
+    }
+    return std::any_of(s.fChildren.begin(), s.fChildren.end(), uses_texture);
+}
+
+// a gradient's colors[] and, with positions, pos[] arrays, named after the shader
+static void print_stops(const FuzzShader& s, const std::string& name) {
+    printf("        const GColor %s_colors[] = {\n", name.c_str());
+    for (const GColor& c : s.fColors) {
+        printf("            ");
+        print_color(c);
+        printf(",\n");
+    }
+    printf("        };\n");
+    if (!s.fPos.empty()) {
+        printf("        const float %s_pos[] = {", name.c_str());
+        for (size_t i = 0; i < s.fPos.size(); ++i) {
+            printf("%s%.9g", i ? ", " : "", s.fPos[i]);
+        }
+        printf("};\n");
+    }
+}
+
+// the stop arguments of a gradient factory: colors, [pos,] count
+static void print_stop_args(const FuzzShader& s, const std::string& name) {
+    printf("%s_colors, ", name.c_str());
+    if (!s.fPos.empty()) {
+        printf("%s_pos, ", name.c_str());
+    }
+    printf("%d", (int) s.fColors.size());
+}
+
+// declares name as the shader s, after its children (name0, name1)
+static void print_shader(const FuzzShader& s, const std::string& name) {
+    static const char* gFilterNames[] = { "kNearest_FilterMode", "kLinear_FilterMode" };
+    static const char* gMipmapNames[] = { "kNone_MipmapMode", "kNearest_MipmapMode" };
+
+    for (size_t i = 0; i < s.fChildren.size(); ++i) {
+        print_shader(s.fChildren[i], name + std::to_string(i));
+    }
+    const char* n = name.c_str();
+    switch (s.fKind) {
+        case FuzzShader::kBitmap:
+            printf("        auto %s = GCreateBitmapShader(texture.bitmap(), ", n);
+            print_matrix(s.fLocalInverse);
+            printf(", GShader::%s,\n                                          GShader::%s, "
+                   "GShader::%s);\n", gTileNames[s.fTileMode], gFilterNames[s.fFilterMode],
+                   gMipmapNames[s.fMipmapMode]);
+            break;
+        case FuzzShader::kLinearGradient:
+            print_stops(s, name);
+            printf("        auto %s = GCreateLinearGradient(", n);
+            print_point(s.fP0);
+            printf(", ");
+            print_point(s.fP1);
+            printf(", ");
+            print_stop_args(s, name);
+            printf(", GShader::%s);\n", gTileNames[s.fTileMode]);
+            break;
+        case FuzzShader::kRadialGradient:
+            print_stops(s, name);
+            printf("        auto %s = GCreateRadialGradient(", n);
+            print_point(s.fP0);
+            printf(", %.9g, ", s.fRadius);
+            print_stop_args(s, name);
+            printf(", GShader::%s);\n", gTileNames[s.fTileMode]);
+            break;
+        case FuzzShader::kSweepGradient:
+            print_stops(s, name);
+            printf("        auto %s = GCreateSweepGradient(", n);
+            print_point(s.fP0);
+            printf(", %.9g, ", s.fStartRadians);
+            print_stop_args(s, name);
+            printf(");\n");
+            break;
+        case FuzzShader::kCompose:
+            printf("        auto %s = GCreateComposeShader(%s0.get(), %s1.get(), "
+                   "GBlendMode::%s);\n", n, n, n, gModeNames[(int) s.fMode]);
+            break;
+        case FuzzShader::kModulate:
+            printf("        auto %s = GCreateModulateShader(%s0.get(), %.9g);\n", n, n, s.fAlpha);
+            break;
+        default:
+            printf("        std::unique_ptr<GShader> %s;\n", n);
+            break;
+    }
+}
+
+static void print_scene(const FuzzScene& scene) {
+    printf("    // %dx%d device, background %s\n", scene.fWidth, scene.fHeight,
+           scene.fBackgroundSeed ? "random" : "transparent");
+    if (scene.fBackgroundSeed) {
+        printf("    fill_background(bitmap, 0x%08X);\n", scene.fBackgroundSeed);
+    }
+    for (const FuzzOp& op : scene.fOps) {
+        printf("    {\n");
+        const FuzzShader& s = op.fShader;
+        if (uses_texture(s)) {
+            printf("        GPixelBuffer texture = make_texture(%u);\n", kTextureSeed);
+        }
+        if (s.fKind != FuzzShader::kNone) {
+            print_shader(s, "shader");
+        }
+        printf("        GPaint paint(");
+        print_color(op.fColor);
+        printf(");\n        paint.setBlendMode(GBlendMode::%s);\n", gModeNames[(int) op.fMode]);
+        if (s.fKind != FuzzShader::kNone) {
+            printf("        paint.setShader(shader.get());\n");
+        }
+        if (!op.fColorMatrix.empty()) {
+            printf("        const float matrix[] = {");
+            for (size_t i = 0; i < op.fColorMatrix.size(); ++i) {
+                printf("%s%.9g", i ? ", " : "", op.fColorMatrix[i]);
+            }
+            printf("};\n        GColorFilter filter(matrix);\n");
+            printf("        paint.setColorFilter(&filter);\n");
+        }
+        printf("        canvas->save();\n        canvas->concat(");
+        print_matrix(op.fMatrix);
+        printf(");\n");
+
+        switch (op.fKind) {
+            case FuzzOp::kRect:
+                printf("        canvas->drawRect(GRect::LTRB(%.9g, %.9g, %.9g, %.9g), paint);\n",
+                       op.fPts[0].x, op.fPts[0].y, op.fPts[1].x, op.fPts[1].y);
+                break;
+            case FuzzOp::kConvexPolygon:
+                printf("        const GPoint pts[] = {");
+                for (size_t i = 0; i < op.fPts.size(); ++i) {
+                    printf(i ? ", " : "");
+                    print_point(op.fPts[i]);
+                }
+                printf("};\n        canvas->drawConvexPolygon(pts, %d, paint);\n",
+                       (int) op.fPts.size());
+                break;
+            case FuzzOp::kPath: {
+                printf("        GPath path;\n");
+                size_t p = 0;
+                for (GPath::Verb verb : op.fVerbs) {
+                    const GPoint* pts = &op.fPts[p];
+                    switch (verb) {
+                        case GPath::kMove:  printf("        path.moveTo("); break;
+                        case GPath::kLine:  printf("        path.lineTo("); break;
+                        case GPath::kQuad:  printf("        path.quadTo("); break;
+                        default:            printf("        path.cubicTo("); break;
+                    }
+                    for (int i = 0; i < verb_points(verb); ++i) {
+                        printf(i ? ", " : "");
+                        print_point(pts[i]);
+                    }
+                    printf(");\n");
+                    p += verb_points(verb);
+                }
+                printf("        canvas->drawPath(path, paint);\n");
+                break;
+            }
+        }
+        printf("        canvas->restore();\n    }\n");
+    }
+}
+
+static bool is_arg(const char arg[], const char name[]) {
+    std::string str("--");
+    str += name;
+    if (!strcmp(arg, str.c_str())) {
+        return true;
+    }
+
+    char shortVers[3];
+    shortVers[0] = '-';
+    shortVers[1] = name[0];
+    shortVers[2] = 0;
+    return !strcmp(arg, shortVers);
+}
+
+int main_fuzz(int argc, const char* argv[]) {
+    uint32_t seed = 0;
+    int iters = 2000;
+    int maxOps = 8;
+    int size = 48;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (is_arg(argv[i], "seed") && i+1 < argc) {
+            seed = (uint32_t) strtoul(argv[++i], nullptr, 0);
+        } else if (is_arg(argv[i], "iters") && i+1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (is_arg(argv[i], "ops") && i+1 < argc) {
+            maxOps = std::max(atoi(argv[++i]), 1);
+        } else if (is_arg(argv[i], "size") && i+1 < argc) {
+            size = std::max(atoi(argv[++i]), 1);
+        } else if (is_arg(argv[i], "verbose")) {
+            verbose = true;
+        } else {
+            printf("Unknown arg %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < iters; ++i, ++seed) {
+        SceneGenerator generator(seed);
+        // vary the device size a little, so row lengths are not always a multiple of the lanes
+        GRandom sizeRand(seed);
+        int w = std::max(size - sizeRand.nextRange(0, 7), 1);
+        int h = std::max(size - sizeRand.nextRange(0, 7), 1);
+        FuzzScene scene = generator.make(w, h, maxOps);
+
+        if (verbose) {
+            printf("seed %u: %d ops\n", seed, (int) scene.fOps.size());
+        }
+        if (!compare(scene).found()) {
+            continue;
+        }
+
+        FuzzScene minimal = minimize(scene);
+        Mismatch m = compare(minimal);
+        printf("MISMATCH at seed %u (replay with --seed %u --iters 1)\n", seed, seed);
+        printf("pixel (%d, %d): fast %08X reference %08X\n", m.fX, m.fY, m.fFast, m.fReference);
+        printf("minimized from %d to %d op(s):\n", (int) scene.fOps.size(),
+               (int) minimal.fOps.size());
+        print_scene(minimal);
+        return 1;
+    }
+    printf("%d scenes matched\n", iters);
+    return 0;
+}
@@ -58,7 +58,7 @@ static double compare(const GBitmap& a, const GBitmap& b, int tolerance, bool ve
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
 static void handle_proc(const GDrawRec& rec, const char path[], GBitmap* bitmap) {
-    bitmap->alloc(rec.fWidth, rec.fHeight);
+    bitmap->alloc(rec.fWidth, rec.fHeight, GBitmap::kAligned_AllocMode);
 
     auto canvas = GCreateCanvas(*bitmap);
     if (!canvas) {
@@ -107,26 +107,24 @@ static void add_diff_to_file(FILE* f, const GBitmap& test, const GBitmap& orig,
                              const char name[]) {
     const int w = test.width();
     const int h = test.height();
-    GBitmap diff0, diff1;
-    diff0.alloc(w, h);
-    diff1.alloc(w, h);
+    GPixelBuffer diff0(w, h), diff1(w, h);
 
     for (int y = 0; y < h; ++y) {
         for (int x = 0; x < w; ++x) {
             int diff = pixel_diff(*test.getAddr(x, y), *orig.getAddr(x, y));
-            *diff0.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
+            *diff0->getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
             if (diff > 0) {
                 diff = 0xFF;
             }
-            *diff1.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
+            *diff1->getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
         }
     }
 
     fprintf(f, "%s<br/>\n", name);
     add_image(f, path, name, "test", test); fprintf(f, "&nbsp;&nbsp;");
     add_image(f, path, name, "orig", orig); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif0", diff0); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif1", diff1); fprintf(f, "<br><br>\n");
+    add_image(f, path, name, "dif0", diff0.bitmap()); fprintf(f, "&nbsp;&nbsp;");
+    add_image(f, path, name, "dif1", diff1.bitmap()); fprintf(f, "<br><br>\n");
 }
 
 static void handle_something(FILE* f, std::string prefix, const char dir[], int index) {
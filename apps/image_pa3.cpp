@@ -10,8 +10,22 @@
 #include "../include/GRandom.h"
 #include "../include/GRect.h"
 #include "../include/GShader.h"
+#include <map>
 #include <string>
 
+// Decode each image once for the life of the program: these drawings are also run over and over
+// as benchmarks (see bench_scenes.inc), where decoding would swamp the drawing.
+static const GBitmap& load_bitmap(const char path[]) {
+    static std::map<std::string, GBitmap> gCache;
+    auto iter = gCache.find(path);
+    if (iter == gCache.end()) {
+        GBitmap bm;
+        bm.readFromFile(path);
+        iter = gCache.emplace(path, bm).first;
+    }
+    return iter->second;
+}
+
 // deliberately take params by value, to ensure that the impl
 // is making a copy, and not just taking its address.
 static std::unique_ptr<GShader> make_bm_shader(GBitmap bm, GMatrix localInv) {
@@ -115,8 +129,7 @@ static void draw_poly_rotate(GCanvas* canvas) {
 }
 
 static void draw_clock_bm(GCanvas* canvas) {
-    GBitmap bm;
-    bm.readFromFile("apps/spock.png");
+    const GBitmap& bm = load_bitmap("apps/spock.png");
 
     float cx = bm.width() * 0.5f;
     float cy = bm.height() * 0.5f;
@@ -153,10 +166,8 @@ static void draw_bitmap(GCanvas* canvas, const GRect& r, const GBitmap& bm, GBle
 }
 
 static void draw_bitmaps_hole(GCanvas* canvas) {
-    GBitmap bm0, bm1;
-    
-    bm0.readFromFile("apps/spock.png");
-    bm1.readFromFile("apps/wheel.png"); // with permission from Alex Niculescu
+    const GBitmap& bm0 = load_bitmap("apps/spock.png");
+    const GBitmap& bm1 = load_bitmap("apps/wheel.png"); // with permission from Alex Niculescu
 
     const GRect r = GRect::WH(300, 300);
     draw_bitmap(canvas, r, bm0, GBlendMode::kSrc);
@@ -106,8 +106,7 @@ static void draw_rings(GCanvas* canvas) {
 
 static void draw_bm_tiling(GCanvas* canvas) {
     const GMatrix m = GMatrix::Scale(2.5f, 2.5f) * GMatrix::Rotate(-gFloatPI/6);
-    GBitmap bm;
-    bm.readFromFile("apps/spock.png");
+    const GBitmap& bm = load_bitmap("apps/spock.png");
     auto sh = GCreateBitmapShader(bm, m, GShader::kRepeat);
     canvas->drawRect(GRect::XYWH(0, 0, 512, 250), GPaint(sh.get()));
     sh = GCreateBitmapShader(bm, m, GShader::kMirror);
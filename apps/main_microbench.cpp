@@ -0,0 +1,11 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include <stdio.h>
+
+extern int main_microbench(int argc, const char* argv[]);
+
+int main(int argc, const char* argv[]) {
+    return main_microbench(argc, argv);
+}
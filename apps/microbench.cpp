@@ -0,0 +1,312 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+/*
+ *  Benchmarks of the individual raster pipeline stages, outside of any GCanvas draw. Each one
+ *  reports the time per element it processes (pixel, edge or point), so a change to one stage
+ *  can be judged without the noise of the rest of the pipeline.
+ */
+
+#include "bench_timer.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvasStats.h"
+#include "../include/GColorFilter.h"
+#include "../include/GMatrix.h"
+#include "../include/GPaint.h"
+#include "../include/GRandom.h"
+#include "../include/GShader.h"
+#include "../blends.h"
+#include "../blitter.h"
+#include "../clip.h"
+#include "../color_filter.h"
+#include "../edge.h"
+#include "../scan_converter.h"
+#include <functional>
+#include <string>
+
+struct MicroBench {
+    std::string fName;
+    const char* fUnit;              // what one element is
+    int fElements;                  // processed by each call to fRun
+    std::function<void()> fRun;
+};
+
+constexpr int kRowCount = 1024;     // pixels per row for the per-pixel kernels
+
+static void add_blend_benches(std::vector<MicroBench>* benches) {
+    static const char* gAlphaNames[NUM_ALPHA_CATEGORIES] = { "zero", "translucent", "opaque" };
+
+    for (int ac = 0; ac < NUM_ALPHA_CATEGORIES; ++ac) {
+        auto src = std::make_shared<std::vector<GPixel>>(kRowCount);
+        auto dst = std::make_shared<std::vector<GPixel>>(kRowCount);
+        GRandom rand(ac);
+        for (int i = 0; i < kRowCount; ++i) {
+            unsigned a = ac == ZERO ? 0 : ac == OPAQUE ? 0xFF : rand.nextRange(1, 0xFE);
+            (*src)[i] = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a),
+                                        rand.nextRange(0, a));
+            unsigned da = rand.nextRange(0, 0xFF);
+            (*dst)[i] = GPixel_PackARGB(da, rand.nextRange(0, da), rand.nextRange(0, da),
+                                        rand.nextRange(0, da));
+        }
+
+        for (int mode = 0; mode < NUM_MODES; ++mode) {
+            BlendFuncPtr blend = blend_lut[mode][ac];
+            benches->push_back({
+                std::string("blend_") + GCanvasStats::BlendModeName(mode) + "_" + gAlphaNames[ac],
+                "px", kRowCount,
+                [=]() {
+                    GPixel* d = dst->data();
+                    const GPixel* s = src->data();
+                    for (int i = 0; i < kRowCount; ++i) {
+                        d[i] = blend(d[i], s[i]);
+                    }
+                }
+            });
+        }
+    }
+}
+
+static const char* tile_name(GShader::TileMode tm) {
+    switch (tm) {
+        case GShader::kClamp:  return "clamp";
+        case GShader::kRepeat: return "repeat";
+        case GShader::kMirror: return "mirror";
+    }
+    return "";
+}
+
+static void add_shader_bench(std::vector<MicroBench>* benches, std::string name,
+                             std::shared_ptr<GShader> shader) {
+    shader->setContext(GMatrix());
+    auto row = std::make_shared<std::vector<GPixel>>(kRowCount);
+    auto y = std::make_shared<int>(0);
+    benches->push_back({
+        name, "px", kRowCount,
+        [=]() { shader->shadeRow(0, (*y)++ & 255, kRowCount, row->data()); }
+    });
+}
+
+static void add_shader_benches(std::vector<MicroBench>* benches) {
+    const GColor colors[] = {
+        GColor::RGBA(1, 0, 0, 1), GColor::RGBA(0, 1, 0, 0.5f), GColor::RGBA(0, 0, 1, 1),
+    };
+
+    static GPixelBuffer gBitmap(64, 64);
+    GRandom rand;
+    visit_pixels(gBitmap.bitmap(), [&](int, int, GPixel* p) {
+        *p = GPixel_PackARGB(0xFF, rand.nextRange(0, 255), rand.nextRange(0, 255),
+                             rand.nextRange(0, 255));
+    });
+    // rotated and magnified a little, so rows wander through the tiles
+    const GMatrix bmInverse = GMatrix::Rotate(0.3f) * GMatrix::Scale(0.4f, 0.4f);
+
+    for (auto tm : { GShader::kClamp, GShader::kRepeat, GShader::kMirror }) {
+        // the gradient spans a quarter of the row, so the tile mode matters for most of it
+        add_shader_bench(benches, std::string("linear_gradient2_") + tile_name(tm),
+                         GCreateLinearGradient({64, 0}, {320, 0}, colors, 2, tm));
+        add_shader_bench(benches, std::string("linear_gradient3_") + tile_name(tm),
+                         GCreateLinearGradient({64, 0}, {320, 0}, colors, 3, tm));
+        add_shader_bench(benches, std::string("radial_gradient3_") + tile_name(tm),
+                         GCreateRadialGradient({192, 0}, 128, colors, 3, tm));
+        add_shader_bench(benches, std::string("bitmap_nearest_") + tile_name(tm),
+                         GCreateBitmapShader(gBitmap.bitmap(), bmInverse, tm));
+        add_shader_bench(benches, std::string("bitmap_linear_") + tile_name(tm),
+                         GCreateBitmapShader(gBitmap.bitmap(), bmInverse, tm,
+                                             GShader::kLinear_FilterMode));
+    }
+    // stop count does not matter once the colors are in a table
+    {
+        constexpr int N = 24;
+        GColor many[N];
+        float pos[N];
+        for (int i = 0; i < N; ++i) {
+            many[i] = colors[i % 3];
+            pos[i] = (float)(i * i) / ((N - 1) * (N - 1));
+        }
+        add_shader_bench(benches, "linear_gradient24_stops",
+                         GCreateLinearGradient({64, 0}, {320, 0}, many, pos, N, GShader::kMirror));
+    }
+    // sweeps have no tile mode; the center sits mid-row, so the row crosses every quadrant
+    add_shader_bench(benches, "sweep_gradient3",
+                     GCreateSweepGradient({192, 128}, 0, colors, 3));
+
+    // a bitmap masked by a gradient, then faded; the children live as long as the benches
+    static auto gMaskBitmap = GCreateBitmapShader(gBitmap.bitmap(), bmInverse, GShader::kRepeat);
+    static auto gMask = GCreateLinearGradient({64, 0}, {320, 0}, colors, 3, GShader::kMirror);
+    static auto gMasked = GCreateComposeShader(gMaskBitmap.get(), gMask.get(),
+                                               GBlendMode::kDstIn);
+    add_shader_bench(benches, "compose_dstin",
+                     GCreateComposeShader(gMaskBitmap.get(), gMask.get(), GBlendMode::kDstIn));
+    add_shader_bench(benches, "modulate_compose",
+                     GCreateModulateShader(gMasked.get(), 0.5f));
+}
+
+static std::vector<GPoint> random_points(int count, float min, float max, uint32_t seed) {
+    GRandom rand(seed);
+    std::vector<GPoint> pts(count);
+    for (GPoint& p : pts) {
+        p = { min + rand.nextF() * (max - min), min + rand.nextF() * (max - min) };
+    }
+    return pts;
+}
+
+/*
+ *  A star shaped polygon with count vertices around the center of a size x size device.
+ */
+static std::vector<GPoint> star_polygon(int count, float size, uint32_t seed) {
+    GRandom rand(seed);
+    std::vector<GPoint> pts(count);
+    for (int i = 0; i < count; ++i) {
+        float angle = 2 * gFloatPI * i / count;
+        float radius = size * (0.1f + 0.4f * rand.nextF());
+        pts[i] = { size / 2 + radius * cosf(angle), size / 2 + radius * sinf(angle) };
+    }
+    return pts;
+}
+
+static void add_color_filter_benches(std::vector<MicroBench>* benches) {
+    auto src = std::make_shared<std::vector<GPixel>>(kRowCount);
+    GRandom rand;
+    for (GPixel& p : *src) {
+        unsigned a = rand.nextRange(0, 0xFF);
+        p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    }
+    const float sepia[20] = {
+        0.393f, 0.769f, 0.189f, 0, 0,
+        0.349f, 0.686f, 0.168f, 0, 0,
+        0.272f, 0.534f, 0.131f, 0, 0,
+        0,      0,      0,      1, 0,
+    };
+    auto add = [&](const char* name, const GColorFilter& filter) {
+        // each run filters a fresh copy of the row, so the pixels stay the same
+        auto row = std::make_shared<std::vector<GPixel>>(kRowCount);
+        benches->push_back({
+            name, "px", kRowCount,
+            [=]() {
+                memcpy(row->data(), src->data(), kRowCount * sizeof(GPixel));
+                filter_row(filter, row->data(), kRowCount);
+            }
+        });
+    };
+    add("color_filter_scale", GColorFilter::Scale(1, 0.8f, 0.6f, 0.5f));
+    add("color_filter_matrix", GColorFilter(sepia));
+}
+
+static void add_geometry_benches(std::vector<MicroBench>* benches) {
+    constexpr int kEdges = 1024;
+    auto pts = std::make_shared<std::vector<GPoint>>(random_points(2 * kEdges, 0, 1024, 1));
+    auto edges = std::make_shared<std::vector<Edge>>(kEdges);
+    benches->push_back({
+        "make_edge_sort", "edge", kEdges,
+        [=]() {
+            for (int i = 0; i < kEdges; ++i) {
+                (*edges)[i] = make_edge((*pts)[2 * i], (*pts)[2 * i + 1], 1);
+            }
+            std::sort(edges->begin(), edges->end(), compare_edge);
+        }
+    });
+
+    // about half of the segments cross the bounds
+    static const GRect gBounds = GRect::WH(1024, 1024);
+    auto poly = std::make_shared<std::vector<GPoint>>(random_points(kEdges, -256, 1280, 2));
+    benches->push_back({
+        "clipper_batch_clip", "pt", kEdges,
+        [=]() {
+            Clipper clipper(gBounds);
+            Edge* out;
+            int count;
+            clipper.batch_clip(poly->data(), (int)poly->size(), &out, count);
+            delete[] out;
+        }
+    });
+
+    // a 1 pixel wide device clamps every span to at most one pixel, which leaves the edge walking
+    // and span generation as the measured work
+    static GPixelBuffer gDevice(1, 1024);
+    for (int n : { 16, 256, 4096, 65536 }) {
+        std::vector<GPoint> star = star_polygon(n, 1024, n);
+        Clipper clipper(gBounds);
+        Edge* out;
+        int count;
+        clipper.batch_clip(star.data(), n, &out, count);
+        auto master = std::make_shared<std::vector<Edge>>(out, out + count);
+        auto work = std::make_shared<std::vector<Edge>>(count);
+        delete[] out;
+
+        // scan_complex consumes its edges, so each run starts from a fresh copy
+        benches->push_back({
+            "scan_complex_" + std::to_string(n), "edge", count,
+            [=]() {
+                std::copy(master->begin(), master->end(), work->begin());
+                Blit blit(gDevice.bitmap(), GIRect::WH(1, 1024), GPaint(GColor::RGBA(0, 0, 1, 1)));
+                ScanConverter::scan_complex(work->data(), (int)work->size(), blit);
+            }
+        });
+    }
+
+    constexpr int kPoints = 4096;
+    auto src = std::make_shared<std::vector<GPoint>>(random_points(kPoints, -100, 100, 3));
+    auto dst = std::make_shared<std::vector<GPoint>>(kPoints);
+    const GMatrix matrix = GMatrix::Translate(10, 20) * GMatrix::Rotate(0.5f) *
+                           GMatrix::Scale(1.5f, 0.75f);
+    benches->push_back({
+        "matrix_map_points", "pt", kPoints,
+        [=]() { matrix.mapPoints(dst->data(), src->data(), kPoints); }
+    });
+}
+
+static bool is_arg(const char arg[], const char name[]) {
+    std::string str("--");
+    str += name;
+    if (!strcmp(arg, str.c_str())) {
+        return true;
+    }
+
+    char shortVers[3];
+    shortVers[0] = '-';
+    shortVers[1] = name[0];
+    shortVers[2] = 0;
+    return !strcmp(arg, shortVers);
+}
+
+int main_microbench(int argc, const char* argv[]) {
+    const char* match = nullptr;
+    BenchTimerOptions timer;
+    timer.fBudgetMS = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        if (is_arg(argv[i], "match") && i+1 < argc) {
+            match = argv[++i];
+        } else if (is_arg(argv[i], "budget") && i+1 < argc) {
+            timer.fBudgetMS = atof(argv[++i]);
+        } else if (is_arg(argv[i], "samples") && i+1 < argc) {
+            timer.fSamples = std::max(atoi(argv[++i]), 1);
+        } else if (is_arg(argv[i], "pin") && i+1 < argc) {
+            int cpu = atoi(argv[++i]);
+            if (!pin_to_cpu(cpu)) {
+                printf("Could not pin to cpu %d, running unpinned\n", cpu);
+            }
+        } else {
+            printf("Unknown arg %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    std::vector<MicroBench> benches;
+    add_blend_benches(&benches);
+    add_shader_benches(&benches);
+    add_color_filter_benches(&benches);
+    add_geometry_benches(&benches);
+
+    for (const MicroBench& bench : benches) {
+        if (match && !strstr(bench.fName.c_str(), match)) {
+            continue;
+        }
+        BenchStats stats = time_bench(bench.fRun, timer);
+        const double scale = 1e6 / bench.fElements;     // ms per run -> ns per element
+        printf("%-32s %9.3f ns/%-4s  (min %.3f p90 %.3f)\n", bench.fName.c_str(),
+               stats.fMedian * scale, bench.fUnit, stats.fMin * scale, stats.fP90 * scale);
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GRandom.h"
+#include "tests.h"
+#include <string>
+#include <unistd.h>
+
+static std::string temp_path(const char name[]) {
+    const char* tmp = getenv("TMPDIR");
+    return std::string(tmp ? tmp : "/tmp") + "/" + name;
+}
+
+// Random premul pixels, with runs and repeats so that every QOI op gets exercised.
+static void fill_random(GBitmap* bm, uint32_t seed) {
+    GRandom rand(seed);
+    GPixel prev = 0;
+    visit_pixels(*bm, [&](int x, int y, GPixel* p) {
+        switch (rand.nextRange(0, 3)) {
+            case 0:  *p = prev; break;
+            case 1:  *p = GPixel_PackARGB(0xFF, x & 0xFF, y & 0xFF, (x + y) & 0xFF); break;
+            default: {
+                unsigned a = rand.nextRange(0, 255);
+                *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a),
+                                     rand.nextRange(0, a));
+            } break;
+        }
+        prev = *p;
+    });
+}
+
+// What survives a trip through an unpremul 8-bit format (png, qoi).
+static bool same_unpremul(const GBitmap& a, const GBitmap& b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        return false;
+    }
+    bool same = true;
+    visit_pixels(a, [&](int x, int y, GPixel* p) {
+        GPixel q = *b.getAddr(x, y);
+        int tol = GPixel_GetA(*p) == 0xFF ? 0 : 1;
+        same &= GPixel_GetA(*p) == GPixel_GetA(q) &&
+                abs(GPixel_GetR(*p) - GPixel_GetR(q)) <= tol &&
+                abs(GPixel_GetG(*p) - GPixel_GetG(q)) <= tol &&
+                abs(GPixel_GetB(*p) - GPixel_GetB(q)) <= tol;
+    });
+    return same;
+}
+
+static void test_qoi_roundtrip(GTestStats* stats) {
+    GBitmap src, png, qoi;
+    src.alloc(67, 31);
+    fill_random(&src, 1);
+
+    const std::string png_path = temp_path("tests_qoi_roundtrip.png");
+    const std::string qoi_path = temp_path("tests_qoi_roundtrip.qoi");
+    EXPECT_TRUE(stats, src.writeToFile(png_path.c_str()));
+    EXPECT_TRUE(stats, src.writeToQOIFile(qoi_path.c_str()));
+    EXPECT_TRUE(stats, png.readFromFile(png_path.c_str()));
+    EXPECT_TRUE(stats, qoi.readFromQOIFile(qoi_path.c_str()));
+
+    // qoi is lossless, so it must match what png gives back exactly
+    EXPECT_TRUE(stats, same_unpremul(src, qoi));
+    EXPECT_EQ(stats, png.width(), qoi.width());
+    EXPECT_EQ(stats, png.height(), qoi.height());
+    EXPECT_EQ(stats, 0, memcmp(png.pixels(), qoi.pixels(), png.height() * png.rowBytes()));
+
+    // readFromFile recognizes qoi on its own
+    GBitmap sniffed;
+    EXPECT_TRUE(stats, sniffed.readFromFile(qoi_path.c_str()));
+    EXPECT_TRUE(stats, same_unpremul(qoi, sniffed));
+
+    unlink(png_path.c_str());
+    unlink(qoi_path.c_str());
+    free(src.pixels());
+    free(png.pixels());
+    free(qoi.pixels());
+    free(sniffed.pixels());
+}
+
+static void test_raw_map(GTestStats* stats) {
+    GBitmap src, mapped, copied;
+    src.alloc(19, 7);
+    fill_random(&src, 2);
+
+    const std::string path = temp_path("tests_raw_map.gbm");
+    EXPECT_TRUE(stats, src.writeToRawFile(path.c_str()));
+    EXPECT_TRUE(stats, mapped.mapRawFile(path.c_str()));
+
+    EXPECT_EQ(stats, src.width(), mapped.width());
+    EXPECT_EQ(stats, src.height(), mapped.height());
+    EXPECT_EQ(stats, (size_t)0, mapped.rowBytes() % 64);
+    EXPECT_EQ(stats, (uintptr_t)0, (uintptr_t)mapped.pixels() % 64);
+
+    // raw is premul GPixels, so it is exact
+    bool same = true;
+    visit_pixels(src, [&](int x, int y, GPixel* p) {
+        same &= *p == *mapped.getAddr(x, y);
+    });
+    EXPECT_TRUE(stats, same);
+
+    EXPECT_TRUE(stats, copied.readFromFile(path.c_str()));
+    same = true;
+    visit_pixels(src, [&](int x, int y, GPixel* p) {
+        same &= *p == *copied.getAddr(x, y);
+    });
+    EXPECT_TRUE(stats, same);
+
+    mapped.unmapRawFile();
+    EXPECT_NULL(stats, mapped.pixels());
+
+    // a png is not a raw file
+    EXPECT_FALSE(stats, mapped.mapRawFile("apps/spock.png"));
+    EXPECT_NULL(stats, mapped.pixels());
+
+    unlink(path.c_str());
+    free(src.pixels());
+    free(copied.pixels());
+}
+
+#include "../include/GCanvas.h"
+
+static void test_aligned_alloc(GTestStats* stats) {
+    for (int w : { 1, 17, 1024, 1040 }) {
+        GPixelBuffer buffer(w, 3);
+        const GBitmap& bm = buffer.bitmap();
+        EXPECT_EQ(stats, (uintptr_t)0, (uintptr_t)bm.pixels() % 64);
+        EXPECT_EQ(stats, (size_t)0, bm.rowBytes() % 64);
+        EXPECT_NE(stats, (size_t)0, bm.rowBytes() % 4096);
+        EXPECT_TRUE(stats, bm.rowBytes() >= w * sizeof(GPixel));
+
+        bool zero = true;
+        visit_pixels(bm, [&](int, int, GPixel* p) { zero &= *p == 0; });
+        EXPECT_TRUE(stats, zero);
+    }
+
+    GPixelBuffer big(2048, 512, GBitmap::kHugePage_AllocMode);
+    EXPECT_PTR(stats, big->pixels());
+    EXPECT_EQ(stats, (size_t)0, big->rowBytes() % 64);
+
+    GPixelBuffer moved(std::move(big));
+    EXPECT_NULL(stats, big->pixels());
+    EXPECT_EQ(stats, 2048, moved->width());
+}
+
+// Drawing into a padded bitmap must touch exactly the same pixels as into a packed one.
+static void test_aligned_draw(GTestStats* stats) {
+    const int w = 37, h = 23;
+    GPixelBuffer packed(w, h, GBitmap::kPacked_AllocMode);
+    GPixelBuffer aligned(w, h, GBitmap::kAligned_AllocMode);
+    EXPECT_NE(stats, packed->rowBytes(), aligned->rowBytes());
+
+    for (const GBitmap* bm : { &packed.bitmap(), &aligned.bitmap() }) {
+        auto canvas = GCreateCanvas(*bm);
+        canvas->clear({0, 0, 1, 1});
+        canvas->fillRect(GRect::LTRB(3, 2, 30, 21), {1, 0, 0, 0.5f});
+        const GPoint tri[] = { {0, 0}, {w, h / 2.0f}, {5, h} };
+        canvas->drawConvexPolygon(tri, 3, GPaint({0, 1, 0, 1}));
+    }
+
+    bool same = true;
+    visit_pixels(packed.bitmap(), [&](int x, int y, GPixel* p) {
+        same &= *p == *aligned->getAddr(x, y);
+    });
+    EXPECT_TRUE(stats, same);
+}
+
+#include "../src/GPixelConvert.h"
+
+// The SIMD converters must match the original per-pixel divides exactly, for every input.
+static void test_pixel_convert(GTestStats* stats) {
+    std::vector<GPixel> premul;
+    std::vector<uint8_t> expected;
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned c = 0; c <= a; ++c) {
+            unsigned u = a ? (c * 255 + a / 2) / a : 0;
+            premul.push_back(GPixel_PackARGB(a, c, a - c, c / 2));
+            unsigned v = a ? ((a - c) * 255 + a / 2) / a : 0;
+            unsigned w = a ? ((c / 2) * 255 + a / 2) / a : 0;
+            expected.insert(expected.end(), {(uint8_t)u, (uint8_t)v, (uint8_t)w, (uint8_t)a});
+        }
+    }
+    const int n = premul.size();
+
+    std::vector<uint8_t> rgba(n * 4), rgba_scalar(n * 4);
+    convert_row_to_rgba(premul.data(), n, rgba.data());
+    convert_row_to_rgba_scalar(premul.data(), n, rgba_scalar.data());
+    EXPECT_TRUE(stats, rgba == expected);
+    EXPECT_TRUE(stats, rgba_scalar == expected);
+
+    rgba.clear();
+    std::vector<GPixel> expected_px;
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned c = 0; c < 256; ++c) {
+            rgba.insert(rgba.end(), {(uint8_t)c, (uint8_t)(255 - c), (uint8_t)(c ^ a), (uint8_t)a});
+            auto mul = [a](unsigned x) { return (a * x + 127) / 255; };
+            expected_px.push_back(GPixel_PackARGB(a, mul(c), mul(255 - c), mul(c ^ a)));
+        }
+    }
+    const int m = expected_px.size();
+
+    // odd offsets and counts, so both the vector body and the scalar tail are hit
+    std::vector<GPixel> px(m), px_scalar(m);
+    convert_row_from_rgba(px.data(), rgba.data(), 3);
+    convert_row_from_rgba(px.data() + 3, rgba.data() + 12, m - 3);
+    convert_row_from_rgba_scalar(px_scalar.data(), rgba.data(), m);
+    EXPECT_TRUE(stats, px == expected_px);
+    EXPECT_TRUE(stats, px_scalar == expected_px);
+
+    // invalid premul (a channel above alpha) saturates to 255 on both paths
+    std::vector<GPixel> invalid;
+    for (unsigned a = 1; a < 256; ++a) {
+        // packed by hand: GPixel_PackARGB asserts valid premul
+        invalid.push_back((a << GPIXEL_SHIFT_A) | (255u << GPIXEL_SHIFT_R) |
+                          (a << GPIXEL_SHIFT_G) | (((a + 255) / 2) << GPIXEL_SHIFT_B));
+    }
+    const int k = invalid.size();
+    std::vector<uint8_t> out(k * 4), out_scalar(k * 4);
+    convert_row_to_rgba(invalid.data(), k, out.data());
+    convert_row_to_rgba_scalar(invalid.data(), k, out_scalar.data());
+    EXPECT_TRUE(stats, out == out_scalar);
+    EXPECT_EQ(stats, out[0], (uint8_t)255);
+    EXPECT_EQ(stats, out[2], (uint8_t)255);
+}
@@ -34,6 +34,9 @@ private:
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_bitmap.cpp"
+#include "tests_shaders.cpp"
+#include "tests_stats.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_clear,       "clear"         },
@@ -59,6 +62,31 @@ const GTestRec gTestRecs[] = {
     { test_path_chop_quad,   "path_chop_quad"    },
     { test_path_chop_cubic,   "path_chop_cubic"    },
 
+    { test_qoi_roundtrip, "qoi_roundtrip"   },
+    { test_raw_map,       "raw_map"         },
+    { test_aligned_alloc, "aligned_alloc"   },
+    { test_aligned_draw,  "aligned_draw"    },
+    { test_pixel_convert, "pixel_convert"   },
+
+    { test_mipmap_levels, "mipmap_levels"   },
+    { test_mipmap_wide,   "mipmap_wide"     },
+    { test_mipmap_shader, "mipmap_shader"   },
+    { test_bitmap_tiling, "bitmap_tiling"   },
+    { test_bitmap_linear, "bitmap_linear"   },
+    { test_bitmap_linear_simd, "bitmap_linear_simd" },
+    { test_bitmap_linear_far, "bitmap_linear_far" },
+    { test_radial_gradient,    "radial_gradient"    },
+    { test_sweep_gradient,     "sweep_gradient"     },
+    { test_compose_shader,     "compose_shader"     },
+    { test_color_filter,       "color_filter"       },
+    { test_gradient_stops,     "gradient_stops"     },
+    { test_row_invariance,     "row_invariance"     },
+    { test_write_through,      "write_through"      },
+    { test_canvas_area,        "canvas_area"        },
+
+    { test_canvas_stats,  "canvas_stats"    },
+    { test_canvas_trace,  "canvas_trace"    },
+
     { nullptr, nullptr },
 };
 
@@ -0,0 +1,735 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GColorFilter.h"
+#include "../include/GMatrix.h"
+#include "../include/GPath.h"
+#include "../include/GRandom.h"
+#include "../include/GShader.h"
+#include "../blends.h"
+#include "../mipmap.h"
+#include "tests.h"
+
+static void test_mipmap_levels(GTestStats* stats) {
+    const GPixel K = GPixel_PackARGB(0xFF, 0, 0, 0);
+    const GPixel W = GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF);
+    const GPixel T = GPixel_PackARGB(0, 0, 0, 0);
+    GPixel pixels[] = {
+        K, W, K, W, K, W, K, W, W,
+        W, K, W, K, W, K, W, K, W,
+        T, T, W, W, T, T, W, W, W,
+        T, T, W, W, T, T, W, W, W,
+    };
+    GBitmap bm(9, 4, 9 * sizeof(GPixel), pixels, false);
+
+    Mipmap mip(bm);
+    EXPECT_EQ(stats, 4, mip.count_levels());     // 9x4, 4x2, 2x1, 1x1
+    EXPECT_EQ(stats, bm.pixels(), mip.level(0).pixels());
+
+    const GBitmap& l1 = mip.level(1);
+    EXPECT_EQ(stats, 4, l1.width());
+    EXPECT_EQ(stats, 2, l1.height());
+
+    // checkerboard averages to 50% gray (rounded), the 9th column is dropped
+    const GPixel G = GPixel_PackARGB(0xFF, 0x80, 0x80, 0x80);
+    bool ok = true;
+    for (int x = 0; x < 4; ++x) {
+        ok &= *l1.getAddr(x, 0) == G;
+        ok &= *l1.getAddr(x, 1) == (x & 1 ? W : T);
+    }
+    EXPECT_TRUE(stats, ok);
+
+    const GBitmap& l2 = mip.level(2);
+    EXPECT_EQ(stats, 2, l2.width());
+    EXPECT_EQ(stats, 1, l2.height());
+
+    // a magnified or 1:1 draw keeps the base level
+    EXPECT_EQ(stats, 0, mip.choose_level(GMatrix()));
+    EXPECT_EQ(stats, 0, mip.choose_level(GMatrix::Scale(0.5f, 0.5f)));
+    EXPECT_EQ(stats, 1, mip.choose_level(GMatrix::Scale(2, 2)));
+    EXPECT_EQ(stats, 2, mip.choose_level(GMatrix::Rotate(1) * GMatrix::Scale(1, 5)));
+    EXPECT_EQ(stats, 3, mip.choose_level(GMatrix::Scale(1000, 1000)));
+}
+
+// The SIMD and scalar parts of the box filter must agree: wide rows exercise both.
+static void test_mipmap_wide(GTestStats* stats) {
+    GPixelBuffer src(37, 6);
+    GRandom rand(3);
+    visit_pixels(src.bitmap(), [&](int, int, GPixel* p) {
+        unsigned a = rand.nextRange(0, 255);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+
+    GPixelBuffer dst(18, 3);
+    downsample_2x2(src.bitmap(), dst.bitmap());
+
+    bool ok = true;
+    visit_pixels(dst.bitmap(), [&](int x, int y, GPixel* p) {
+        for (int shift : { 0, 8, 16, 24 }) {
+            unsigned sum = 2;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    sum += (*src->getAddr(2 * x + dx, 2 * y + dy) >> shift) & 0xFF;
+                }
+            }
+            ok &= ((*p >> shift) & 0xFF) == (sum >> 2);
+        }
+    });
+    EXPECT_TRUE(stats, ok);
+}
+
+// Minifying a 1px checkerboard should give gray with mipmaps, not an aliased solid color.
+static void test_mipmap_shader(GTestStats* stats) {
+    const GPixel K = GPixel_PackARGB(0xFF, 0, 0, 0);
+    const GPixel W = GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF);
+    GPixelBuffer checker(64, 64);
+    visit_pixels(checker.bitmap(), [&](int x, int y, GPixel* p) {
+        *p = ((x ^ y) & 1) ? W : K;
+    });
+
+    GPixelBuffer device(8, 8);
+    auto canvas = GCreateCanvas(device.bitmap());
+
+    auto mip = GCreateBitmapShader(checker.bitmap(), GMatrix::Scale(8, 8), GShader::kClamp,
+                                   GShader::kNearest_FilterMode, GShader::kNearest_MipmapMode);
+    canvas->drawRect(GRect::WH(8, 8), GPaint(mip.get()));
+
+    bool gray = true;
+    visit_pixels(device.bitmap(), [&](int, int, GPixel* p) {
+        gray &= GPixel_GetA(*p) == 0xFF && abs(GPixel_GetR(*p) - 0x80) <= 1;
+    });
+    EXPECT_TRUE(stats, gray);
+
+    auto nearest = GCreateBitmapShader(checker.bitmap(), GMatrix::Scale(8, 8));
+    canvas->drawRect(GRect::WH(8, 8), GPaint(nearest.get()));
+    EXPECT_TRUE(stats, GPixel_GetR(*device->getAddr(3, 3)) == 0 ||
+                       GPixel_GetR(*device->getAddr(3, 3)) == 0xFF);
+}
+
+static void test_bitmap_tiling(GTestStats* stats) {
+    const GPixel A = GPixel_PackARGB(0xFF, 0xFF, 0, 0);
+    const GPixel B = GPixel_PackARGB(0xFF, 0, 0xFF, 0);
+    const GPixel C = GPixel_PackARGB(0xFF, 0, 0, 0xFF);
+    GPixel pixels[] = { A, B, C };
+    GBitmap bm(3, 1, sizeof(pixels), pixels, true);
+
+    auto expect_row = [&](GShader::TileMode mode, const std::vector<GPixel>& expected) {
+        auto sh = GCreateBitmapShader(bm, GMatrix(), mode);
+        EXPECT_TRUE(stats, sh->setContext(GMatrix()));
+        std::vector<GPixel> row(expected.size());
+        sh->shadeRow(-4, 0, row.size(), row.data());
+        EXPECT_TRUE(stats, row == expected);
+    };
+    expect_row(GShader::kClamp,  { A, A, A, A, A, B, C, C, C, C });
+    expect_row(GShader::kRepeat, { C, A, B, C, A, B, C, A, B, C });
+    expect_row(GShader::kMirror, { C, C, B, A, A, B, C, C, B, A });
+}
+
+static void test_bitmap_linear(GTestStats* stats) {
+    const GPixel A = GPixel_PackARGB(0xFF, 0xFF, 0, 0);
+    const GPixel B = GPixel_PackARGB(0x80, 0, 0, 0x80);
+    GPixel pixels[] = { A, B };
+    GBitmap bm(2, 1, sizeof(pixels), pixels, false);
+
+    // unscaled, every pixel center lands on a texel center
+    auto sh = GCreateBitmapShader(bm, GMatrix(), GShader::kClamp, GShader::kLinear_FilterMode);
+    EXPECT_TRUE(stats, sh->setContext(GMatrix()));
+    GPixel row[6];
+    sh->shadeRow(-2, 0, 6, row);
+    EXPECT_TRUE(stats, row[0] == A && row[1] == A && row[2] == A && row[3] == B && row[5] == B);
+
+    // 4x up: the samples ramp from A to B between the two texel centers
+    sh = GCreateBitmapShader(bm, GMatrix::Scale(0.25f, 0.25f), GShader::kClamp,
+                             GShader::kLinear_FilterMode);
+    EXPECT_TRUE(stats, sh->setContext(GMatrix()));
+    GPixel up[8];
+    sh->shadeRow(0, 0, 8, up);
+    EXPECT_TRUE(stats, up[0] == A && up[1] == A && up[6] == B && up[7] == B);
+    bool ramp = true;
+    for (int i = 2; i < 6; ++i) {
+        ramp &= GPixel_GetA(up[i]) < GPixel_GetA(up[i - 1]);
+        ramp &= GPixel_GetR(up[i]) < GPixel_GetR(up[i - 1]);
+        ramp &= GPixel_GetB(up[i]) > GPixel_GetB(up[i - 1]);
+        ramp &= GPixel_GetR(up[i]) <= GPixel_GetA(up[i]) && GPixel_GetB(up[i]) <= GPixel_GetA(up[i]);
+    }
+    EXPECT_TRUE(stats, ramp);
+}
+
+// Wide rows (vectorized) must match pixel at a time (scalar) sampling, for every tile mode,
+// with and without rotation. The matrices are exact in 16.16 so stepping along a row does not
+// drift from starting a new row at each pixel.
+static void test_bitmap_linear_simd(GTestStats* stats) {
+    GPixelBuffer src(13, 7);
+    GRandom rand(5);
+    visit_pixels(src.bitmap(), [&](int, int, GPixel* p) {
+        unsigned a = rand.nextRange(0, 255);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+
+    const GMatrix matrices[] = {
+        GMatrix::Scale(0.3125f, 0.375f),
+        GMatrix(0.375f, -0.25f, 1.5f, 0.3125f, 0.4375f, -2.25f),
+        GMatrix::Translate(-3.25f, 2.125f) * GMatrix::Scale(1.6875f, 1.25f),
+    };
+    bool same = true;
+    for (auto tm : { GShader::kClamp, GShader::kRepeat, GShader::kMirror }) {
+        for (const GMatrix& m : matrices) {
+            auto sh = GCreateBitmapShader(src.bitmap(), m, tm, GShader::kLinear_FilterMode);
+            sh->setContext(GMatrix());
+            for (int y = -5; y < 20; y += 3) {
+                GPixel row[37];
+                sh->shadeRow(-9, y, 37, row);
+                for (int i = 0; i < 37; ++i) {
+                    GPixel one;
+                    sh->shadeRow(-9 + i, y, 1, &one);
+                    same &= one == row[i];
+                }
+            }
+        }
+    }
+    EXPECT_TRUE(stats, same);
+}
+
+// Repeat and mirror are periodic, so shifting the bitmap by whole periods must not change a
+// pixel, even tens of thousands of texels away (past where 16.16 fits in 32 bits).
+static void test_bitmap_linear_far(GTestStats* stats) {
+    GPixelBuffer src(8, 4);
+    GRandom rand(9);
+    visit_pixels(src.bitmap(), [&](int, int, GPixel* p) {
+        unsigned a = rand.nextRange(0, 255);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+
+    // 4x up, so the samples fall between texels; every value here is exact in a float
+    auto shade = [&](GShader::TileMode tm, float offset, std::vector<GPixel>* row) {
+        const GMatrix m = GMatrix::Translate(offset, offset) * GMatrix::Scale(0.25f, 0.25f);
+        auto sh = GCreateBitmapShader(src.bitmap(), m, tm, GShader::kLinear_FilterMode);
+        sh->setContext(GMatrix());
+        sh->shadeRow(-300, 5, row->size(), row->data());
+    };
+    for (auto tm : { GShader::kRepeat, GShader::kMirror }) {
+        std::vector<GPixel> near(2000), far(2000), before(2000);
+        shade(tm, 0, &near);
+        shade(tm, 50000, &far);
+        shade(tm, -50000, &before);
+        EXPECT_TRUE(stats, near == far);
+        EXPECT_TRUE(stats, near == before);
+    }
+}
+
+static void test_radial_gradient(GTestStats* stats) {
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 0, 1, 1} };
+    EXPECT_NULL(stats, GCreateRadialGradient({0, 0}, 10, colors, 0).get());
+    EXPECT_NULL(stats, GCreateRadialGradient({0, 0}, 0, colors, 2).get());
+
+    // centered on pixel 50, 50
+    auto sh = GCreateRadialGradient({50.5f, 50.5f}, 40, colors, 2);
+    EXPECT_TRUE(stats, sh->isOpaque());
+    sh->setContext(GMatrix());
+
+    // shade a whole (chunked, vectorized) row at once, and single pixels, along y = 50
+    GPixel row[100];
+    sh->shadeRow(0, 50, 100, row);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0xFF, 0, 0), row[50]);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0, 0, 0xFF), row[5]);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0, 0, 0xFF), row[95]);
+
+    // symmetric about the center, and the same along a column as along the row
+    bool symmetric = true;
+    for (int i = 0; i < 50; ++i) {
+        GPixel up;
+        sh->shadeRow(50, 50 - i, 1, &up);
+        symmetric &= row[50 - i] == row[50 + i] && up == row[50 + i];
+    }
+    EXPECT_TRUE(stats, symmetric);
+
+    // the red channel falls off with the distance from the center
+    bool ramp = true;
+    for (int i = 51; i < 90; ++i) {
+        ramp &= GPixel_GetR(row[i]) <= GPixel_GetR(row[i - 1]);
+    }
+    EXPECT_TRUE(stats, ramp);
+
+    // repeat starts over every radius
+    auto rep = GCreateRadialGradient({0.5f, 0.5f}, 16, colors, 2, GShader::kRepeat);
+    rep->setContext(GMatrix());
+    GPixel wide[64];
+    rep->shadeRow(0, 0, 64, wide);
+    EXPECT_EQ(stats, wide[3], wide[19]);
+    EXPECT_EQ(stats, wide[3], wide[35]);
+
+    // the vector loop and the reference backend's scalar one step the squared distance alike,
+    // even where it is tiny next to its rounding (fuzz seed 896: pixel 34, 34 came out different)
+    const GColor five[] = {
+        {0.564230382f, 0.0107361078f, 0.953280509f, 1},
+        {0.798821151f, 0.210196376f, 0.555907547f, 1},
+        {0.589812219f, 0.617469907f, 0.53002888f, 1},
+        {0.59693259f, 0.652783751f, 0.307346165f, 1},
+        {0.21526283f, 0.795935273f, 0.593975127f, 1},
+    };
+    auto near = GCreateRadialGradient({33.3130035f, 34.5f}, 24.2122955f, five, 5);
+    auto same_as_reference = [](GShader* sh, const GPoint pts[3], int w, int h) {
+        GPixelBuffer fast(w, h), ref(w, h);
+        GPaint paint(sh);
+        GCreateCanvas(fast.bitmap())->drawConvexPolygon(pts, 3, paint);
+        GCreateReferenceCanvas(ref.bitmap())->drawConvexPolygon(pts, 3, paint);
+        bool same = true;
+        for (int y = 0; y < h; ++y) {
+            same &= !memcmp(fast->getAddr(0, y), ref->getAddr(0, y), w * sizeof(GPixel));
+        }
+        return same;
+    };
+    const GPoint nearPts[] = { {58.7789726f, 34.5563316f}, {0.552259445f, 41.278965f},
+                               {-1.91324997f, 32.011322f} };
+    EXPECT_TRUE(stats, same_as_reference(near.get(), nearPts, 41, 46));
+
+    // and the steps can undershoot 0 right at the center, which repeat would tile to the far
+    // end (fuzz seed 54915: pixel 48, 61)
+    const GColor two[] = {
+        {0.896623909f, 0.346317291f, 0.22263521f, 0.989522815f},
+        {0.259268999f, 0.164127529f, 0.808056235f, 0.224184573f},
+    };
+    auto center = GCreateRadialGradient({48.4957123f, 61.5f}, 44.5829353f, two, 2,
+                                        GShader::kRepeat);
+    const GPoint centerPts[] = { {14.9260712f, 98.8973236f}, {64.3966522f, -6.30519867f},
+                                 {114.405846f, 72.6818237f} };
+    EXPECT_TRUE(stats, same_as_reference(center.get(), centerPts, 94, 95));
+}
+
+static void test_sweep_gradient(GTestStats* stats) {
+    const GColor colors[] = { {0, 0, 0, 1}, {1, 1, 1, 1} };
+    EXPECT_NULL(stats, GCreateSweepGradient({0, 0}, 0, colors, 0).get());
+
+    // black to white over one turn, so the red channel reads back the angle (in 255ths of a turn)
+    auto sh = GCreateSweepGradient({50.5f, 50.5f}, 0, colors, 2);
+    EXPECT_TRUE(stats, sh->isOpaque());
+    sh->setContext(GMatrix());
+
+    // rows of 101 cover the vector lanes and the scalar tail; each must match pixel by pixel
+    // shading, and land within one table step of libm's atan2f (clockwise on screen from +x)
+    bool close = true, consistent = true;
+    GPixel row[101];
+    for (int y = 0; y < 101; y += 5) {
+        sh->shadeRow(0, y, 101, row);
+        for (int x = 0; x < 101; ++x) {
+            GPixel single;
+            sh->shadeRow(x, y, 1, &single);
+            consistent &= single == row[x];
+
+            float t = atan2f(y - 50.0f, x - 50.0f) / (2 * 3.14159265f);
+            t = t < 0 ? t + 1 : t;
+            const int expected = (int)(t * 255 + 0.5f);
+            // right along the seam just above +x, t may round to either end
+            const int diff = std::abs(GPixel_GetR(row[x]) - expected);
+            close &= diff <= 1 || diff >= 254;
+        }
+    }
+    EXPECT_TRUE(stats, consistent);
+    EXPECT_TRUE(stats, close);
+
+    // the quadrants: +x is the start, +y (down) is a quarter turn, -x half, -y three quarters
+    sh->shadeRow(50, 50, 1, row);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0, 0, 0), row[0]);   // the center itself
+    sh->shadeRow(90, 50, 1, row);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0, 0, 0), row[0]);
+    sh->shadeRow(50, 90, 1, row);
+    EXPECT_EQ(stats, 64, (int)GPixel_GetR(row[0]));
+    sh->shadeRow(10, 50, 1, row);
+    EXPECT_EQ(stats, 128, (int)GPixel_GetR(row[0]));
+    sh->shadeRow(50, 10, 1, row);
+    EXPECT_EQ(stats, 191, (int)GPixel_GetR(row[0]));
+
+    // the start angle turns the whole sweep: starting at +y puts black straight down
+    auto turned = GCreateSweepGradient({50.5f, 50.5f}, 3.14159265f / 2, colors, 2);
+    turned->setContext(GMatrix());
+    turned->shadeRow(50, 90, 1, row);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0, 0, 0), row[0]);
+    turned->shadeRow(10, 50, 1, row);
+    EXPECT_EQ(stats, 64, (int)GPixel_GetR(row[0]));
+}
+
+static void test_compose_shader(GTestStats* stats) {
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 0, 1, 0.25f}, {0, 1, 0, 1} };
+    auto opaque = GCreateLinearGradient({0, 0}, {300, 0}, colors[0], colors[2]);
+    auto mask = GCreateLinearGradient({0, 0}, {300, 0}, colors, 3, GShader::kMirror);
+    EXPECT_NULL(stats, GCreateComposeShader(opaque.get(), nullptr, GBlendMode::kSrc).get());
+    EXPECT_NULL(stats, GCreateModulateShader(nullptr, 1).get());
+
+    auto over = GCreateComposeShader(opaque.get(), mask.get(), GBlendMode::kSrcOver);
+    auto in = GCreateComposeShader(opaque.get(), mask.get(), GBlendMode::kDstIn);
+    EXPECT_TRUE(stats, over->isOpaque());
+    EXPECT_FALSE(stats, in->isOpaque());
+
+    // a row spanning several chunks (and a ragged last one) matches blending the children's rows
+    for (auto mode : { GBlendMode::kSrcOver, GBlendMode::kDstIn, GBlendMode::kXor }) {
+        auto sh = GCreateComposeShader(opaque.get(), mask.get(), mode);
+        EXPECT_TRUE(stats, sh->setContext(GMatrix()));
+
+        GPixel row[300], dst[300], src[300];
+        sh->shadeRow(0, 0, 300, row);
+        opaque->shadeRow(0, 0, 300, dst);
+        mask->shadeRow(0, 0, 300, src);
+
+        bool same = true;
+        for (int i = 0; i < 300; ++i) {
+            same &= row[i] == blend_func(mode, src[i])(dst[i], src[i]);
+        }
+        EXPECT_TRUE(stats, same);
+    }
+
+    // modulating by 1 changes nothing, by 0.5 halves every (premul) channel
+    auto full = GCreateModulateShader(opaque.get(), 1);
+    auto half = GCreateModulateShader(opaque.get(), 0.5f);
+    EXPECT_TRUE(stats, full->isOpaque());
+    EXPECT_FALSE(stats, half->isOpaque());
+    full->setContext(GMatrix());
+    half->setContext(GMatrix());
+
+    GPixel a[100], b[100], c[100];
+    opaque->shadeRow(0, 0, 100, a);
+    full->shadeRow(0, 0, 100, b);
+    half->shadeRow(0, 0, 100, c);
+    bool unchanged = true, halved = true;
+    for (int i = 0; i < 100; ++i) {
+        unchanged &= a[i] == b[i];
+        halved &= GPixel_GetA(c[i]) == 128 &&
+                  std::abs((int)GPixel_GetR(c[i]) * 2 - (int)GPixel_GetR(a[i])) <= 1 &&
+                  std::abs((int)GPixel_GetB(c[i]) * 2 - (int)GPixel_GetB(a[i])) <= 1;
+    }
+    EXPECT_TRUE(stats, unchanged);
+    EXPECT_TRUE(stats, halved);
+}
+
+static void test_color_filter(GTestStats* stats) {
+    EXPECT_TRUE(stats, GColorFilter::Scale(1, 0.5f, 0, 1).isScale());
+    EXPECT_FALSE(stats, GColorFilter::Scale(2, 1, 1, 1).isScale());
+    const float gray[20] = {
+        0.2126f, 0.7152f, 0.0722f, 0, 0,
+        0.2126f, 0.7152f, 0.0722f, 0, 0,
+        0.2126f, 0.7152f, 0.0722f, 0, 0,
+        0,       0,       0,       1, 0,
+    };
+    const GColorFilter desaturate(gray);
+    EXPECT_FALSE(stats, desaturate.isScale());
+
+    GPixelBuffer device(70, 4);
+    auto canvas = GCreateCanvas(device.bitmap());
+
+    // a solid color is filtered once, up front
+    GPaint paint(GColor::RGBA(1, 0, 0, 1));
+    paint.setBlendMode(GBlendMode::kSrc).setColorFilter(&desaturate);
+    canvas->drawRect(GRect::WH(70, 4), paint);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 54, 54, 54), *device->getAddr(0, 0));
+
+    // a filter can make a transparent color visible, so the draw must not be skipped
+    const float opaque[20] = { 0, 0, 0, 0, 1,  0, 0, 0, 0, 0,  0, 0, 0, 0, 0,  0, 0, 0, 0, 1 };
+    const GColorFilter makeOpaque(opaque);
+    GPaint clear(GColor::RGBA(0, 0, 0, 0));
+    clear.setColorFilter(&makeOpaque);
+    canvas->drawRect(GRect::WH(70, 4), clear);
+    EXPECT_EQ(stats, GPixel_PackARGB(0xFF, 0xFF, 0, 0), *device->getAddr(0, 0));
+
+    // shaded rows: the vector loops (and the tails) match the reference backend's scalar ones
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 1, 0, 0.3f}, {0, 0, 1, 1} };
+    auto sh = GCreateLinearGradient({0, 0}, {70, 0}, colors, 3);
+    GPixelBuffer ref(70, 4);
+    auto refCanvas = GCreateReferenceCanvas(ref.bitmap());
+    const GColorFilter fade = GColorFilter::Scale(1, 0.5f, 0.25f, 0.5f);
+    bool same = true;
+    for (const GColorFilter* filter : { &desaturate, &makeOpaque, &fade }) {
+        GPaint p(sh.get());
+        p.setBlendMode(GBlendMode::kSrc).setColorFilter(filter);
+        canvas->drawRect(GRect::WH(69, 4), p);
+        refCanvas->drawRect(GRect::WH(69, 4), p);
+        same &= !memcmp(device->getAddr(0, 0), ref->getAddr(0, 0), 69 * sizeof(GPixel));
+    }
+    EXPECT_TRUE(stats, same);
+
+    // the scale scales premul pixels: alpha and red by half, green by a quarter, blue by 1/8
+    GPixel row[70];
+    sh->setContext(GMatrix());
+    sh->shadeRow(0, 0, 70, row);
+    const GPixel p = row[40], q = *ref->getAddr(40, 0);
+    EXPECT_EQ(stats, (GPixel_GetA(p) + 1) / 2, GPixel_GetA(q));
+    EXPECT_EQ(stats, (GPixel_GetR(p) + 1) / 2, GPixel_GetR(q));
+    EXPECT_EQ(stats, (GPixel_GetG(p) + 2) / 4, GPixel_GetG(q));
+    EXPECT_EQ(stats, (GPixel_GetB(p) + 4) / 8, GPixel_GetB(q));
+}
+
+static void test_gradient_stops(GTestStats* stats) {
+    const GPixel R = GPixel_PackARGB(0xFF, 0xFF, 0, 0);
+    const GPixel G = GPixel_PackARGB(0xFF, 0, 0xFF, 0);
+    const GPixel B = GPixel_PackARGB(0xFF, 0, 0, 0xFF);
+
+    // green a quarter of the way along, instead of half: pixel x is at t = x / 256
+    const GColor rgb[] = { {1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1} };
+    const float quarter[] = { 0, 0.25f, 1 };
+    auto sh = GCreateLinearGradient({0.5f, 0}, {256.5f, 0}, rgb, quarter, 3);
+    sh->setContext(GMatrix());
+    GPixel row[257];
+    sh->shadeRow(0, 0, 257, row);
+    EXPECT_EQ(stats, R, row[0]);
+    EXPECT_EQ(stats, G, row[64]);
+    EXPECT_EQ(stats, B, row[256]);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetB(row[160]) - 0x80) <= 1);
+
+    // null positions are the evenly spaced gradient
+    auto even = GCreateLinearGradient({0, 0}, {256, 0}, rgb, 3);
+    auto evenPos = GCreateLinearGradient({0, 0}, {256, 0}, rgb, nullptr, 3);
+    even->setContext(GMatrix());
+    evenPos->setContext(GMatrix());
+    GPixel a[256], b[256];
+    even->shadeRow(0, 0, 256, a);
+    evenPos->shadeRow(0, 0, 256, b);
+    EXPECT_TRUE(stats, !memcmp(a, b, sizeof(a)));
+    EXPECT_TRUE(stats, GPixel_GetG(a[128]) >= 0xFE);   // the table has no entry at exactly 0.5
+
+    // spread over 1024 pixels, each table entry covers 4 of them: blending the entries keeps
+    // neighbors within one value of each other, where the nearest entry would step by two. The
+    // same goes for a large radial gradient, and for a sweep far from its center.
+    auto max_step = [](GShader* sh, int y) {
+        sh->setContext(GMatrix());
+        std::vector<GPixel> ramp(1024);
+        sh->shadeRow(0, y, 1024, ramp.data());
+        int maxStep = 0;
+        for (int i = 1; i < 1024; ++i) {
+            for (int shift : { GPIXEL_SHIFT_R, GPIXEL_SHIFT_G, GPIXEL_SHIFT_B }) {
+                const int c0 = (ramp[i - 1] >> shift) & 0xFF, c1 = (ramp[i] >> shift) & 0xFF;
+                maxStep = std::max(maxStep, std::abs(c1 - c0));
+            }
+        }
+        return maxStep;
+    };
+    EXPECT_EQ(stats, 1, max_step(GCreateLinearGradient({0, 0}, {1024, 0}, rgb, 3).get(), 0));
+    EXPECT_EQ(stats, 1, max_step(GCreateRadialGradient({0.5f, 0.5f}, 1024, rgb, 3).get(), 0));
+    EXPECT_EQ(stats, 1, max_step(GCreateSweepGradient({512.5f, 300.5f}, 0, rgb, 3).get(), 0));
+
+    // many stops, some tied and some crowded into one table entry, still come out as the
+    // colors between the stops either side of each pixel
+    constexpr int N = 30;
+    GColor many[N];
+    float pos[N];
+    GRandom rand(5);
+    for (int i = 0; i < N; ++i) {
+        many[i] = { rand.nextF(), rand.nextF(), rand.nextF(), 1 };
+        pos[i] = rand.nextF();
+    }
+    std::sort(pos, pos + N);
+    pos[7] = pos[6];                    // a hard edge
+    pos[21] = pos[20] + 0.001f;         // less than an entry apart
+    pos[22] = pos[20] + 0.002f;
+    auto crowded = GCreateLinearGradient({0, 0}, {4096, 0}, many, pos, N);
+    crowded->setContext(GMatrix());
+    std::vector<GPixel> wide(4096);
+    crowded->shadeRow(0, 0, 4096, wide.data());
+    bool close = true;
+    for (int x = 0; x < 4096; ++x) {
+        const float t = (x + 0.5f) / 4096;
+        int stop = 0;
+        while (stop < N && pos[stop] <= t) {
+            ++stop;
+        }
+        GColor c = many[std::min(stop, N - 1)];
+        if (stop > 0 && stop < N) {
+            const float w = (t - pos[stop - 1]) / (pos[stop] - pos[stop - 1]);
+            const GColor& c0 = many[stop - 1];
+            c = { c0.r + (c.r - c0.r) * w, c0.g + (c.g - c0.g) * w, c0.b + (c.b - c0.b) * w, 1 };
+        }
+        close &= std::abs((int)GPixel_GetR(wide[x]) - GRoundToInt(c.r * 255)) <= 1 &&
+                 std::abs((int)GPixel_GetG(wide[x]) - GRoundToInt(c.g * 255)) <= 1 &&
+                 std::abs((int)GPixel_GetB(wide[x]) - GRoundToInt(c.b * 255)) <= 1;
+    }
+    EXPECT_TRUE(stats, close);
+
+    // the blended (and vector) loops draw what the reference backend's scalar ones do
+    auto big = GCreateRadialGradient({20.5f, -300}, 400, many, pos, N, GShader::kMirror);
+    auto dial = GCreateSweepGradient({30, 700}, 0.5f, many, pos, N);
+    GPixelBuffer fast(67, 64), ref(67, 64);
+    auto canvas = GCreateCanvas(fast.bitmap());
+    auto refCanvas = GCreateReferenceCanvas(ref.bitmap());
+    for (GShader* sh : { big.get(), dial.get(), crowded.get() }) {
+        GPaint paint(sh);
+        paint.setBlendMode(GBlendMode::kSrcOver);
+        for (GCanvas* c : { canvas.get(), refCanvas.get() }) {
+            c->save();
+            c->concat(GMatrix::Scale(0.03f, 1));
+            c->drawRect(GRect::WH(67 / 0.03f, 64), paint);
+            c->restore();
+        }
+    }
+    bool same = true;
+    for (int y = 0; y < 64; ++y) {
+        same &= !memcmp(fast->getAddr(0, y), ref->getAddr(0, y), 67 * sizeof(GPixel));
+    }
+    EXPECT_TRUE(stats, same);
+
+    // two stops in the same place make a hard edge; before the first and after the last stop
+    // the end colors carry on
+    const GColor rrbb[] = { {1, 0, 0, 1}, {1, 0, 0, 1}, {0, 0, 1, 1}, {0, 0, 1, 1} };
+    const float hard[] = { 0.25f, 0.5f, 0.5f, 0.75f };
+    auto edge = GCreateLinearGradient({0, 0}, {256, 0}, rrbb, hard, 4);
+    edge->setContext(GMatrix());
+    edge->shadeRow(0, 0, 256, row);
+    bool split = true;
+    for (int i = 0; i < 256; ++i) {
+        split &= row[i] == (i < 128 ? R : B);
+    }
+    EXPECT_TRUE(stats, split);
+
+    // radial and sweep gradients take the stops too
+    auto radial = GCreateRadialGradient({0.5f, 0.5f}, 256, rgb, quarter, 3);
+    radial->setContext(GMatrix());
+    radial->shadeRow(0, 0, 256, row);
+    EXPECT_EQ(stats, G, row[64]);
+    auto sweep = GCreateSweepGradient({0, 0}, 0, rrbb, hard, 4);
+    EXPECT_PTR(stats, sweep.get());
+}
+
+static void test_row_invariance(GTestStats* stats) {
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 0, 1, 0.5f} };
+    auto horizontal = GCreateLinearGradient({0, 0}, {64, 0}, colors, 2);
+    auto vertical = GCreateLinearGradient({0, 0}, {0, 64}, colors, 2);
+    auto diagonal = GCreateLinearGradient({0, 0}, {64, 64}, colors, 2);
+    auto radial = GCreateRadialGradient({32, 32}, 32, colors, 2);
+    for (GShader* sh : { horizontal.get(), vertical.get(), diagonal.get(), radial.get() }) {
+        sh->setContext(GMatrix());
+    }
+    EXPECT_EQ(stats, GShader::kConstantY_RowInvariance, horizontal->rowInvariance());
+    EXPECT_EQ(stats, GShader::kConstantX_RowInvariance, vertical->rowInvariance());
+    EXPECT_EQ(stats, GShader::kNone_RowInvariance, diagonal->rowInvariance());
+    EXPECT_EQ(stats, GShader::kNone_RowInvariance, radial->rowInvariance());
+
+    // a bitmap magnified 4x repeats each texel row 4 times; rotated, it does not repeat
+    GPixelBuffer texture(8, 8);
+    GRandom rand;
+    visit_pixels(texture.bitmap(), [&](int, int, GPixel* p) {
+        *p = GPixel_PackARGB(0xFF, rand.nextRange(0, 255), rand.nextRange(0, 255), 0);
+    });
+    auto scaled = GCreateBitmapShader(texture.bitmap(), GMatrix::Scale(0.25f, 0.25f),
+                                      GShader::kRepeat);
+    scaled->setContext(GMatrix());
+    EXPECT_EQ(stats, GShader::kKeyed_RowInvariance, scaled->rowInvariance());
+    EXPECT_EQ(stats, scaled->rowKey(0), scaled->rowKey(3));
+    EXPECT_NE(stats, scaled->rowKey(3), scaled->rowKey(4));
+    EXPECT_EQ(stats, scaled->rowKey(4), scaled->rowKey(36));     // repeats every 32 rows
+    scaled->setContext(GMatrix::Rotate(0.1f));
+    EXPECT_EQ(stats, GShader::kNone_RowInvariance, scaled->rowInvariance());
+
+    // the cached and filled rows draw exactly what shading every row does, also when the spans
+    // of a path start and end at different x on each row
+    auto linear = GCreateBitmapShader(texture.bitmap(), GMatrix::Scale(0.3f, 0.3f),
+                                      GShader::kMirror, GShader::kLinear_FilterMode);
+    GPath path;
+    path.moveTo({3, 1}).lineTo({60, 20}).lineTo({30, 63}).lineTo({1, 40});
+    GPixelBuffer fast(64, 64), ref(64, 64);
+    auto canvas = GCreateCanvas(fast.bitmap());
+    auto refCanvas = GCreateReferenceCanvas(ref.bitmap());
+    for (GShader* sh : { horizontal.get(), vertical.get(), scaled.get(), linear.get() }) {
+        for (auto mode : { GBlendMode::kSrcOver, GBlendMode::kSrc, GBlendMode::kDstIn }) {
+            GPaint paint(sh);
+            paint.setBlendMode(mode);
+            for (GCanvas* c : { canvas.get(), refCanvas.get() }) {
+                c->drawRect(GRect::LTRB(5, 5, 50, 60), paint);
+                c->drawPath(path, paint);
+            }
+        }
+    }
+    bool same = true;
+    for (int y = 0; y < 64; ++y) {
+        same &= !memcmp(fast->getAddr(0, y), ref->getAddr(0, y), 64 * sizeof(GPixel));
+    }
+    EXPECT_TRUE(stats, same);
+}
+
+static void test_write_through(GTestStats* stats) {
+    // rows that do not repeat, so these are shaded straight into the device when the mode allows
+    const GColor opaque[] = { {1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1} };
+    const GColor clear[] = { {1, 0, 0, 1}, {0, 1, 0, 0}, {0, 0, 1, 0.5f} };
+    auto solid = GCreateRadialGradient({20, 30}, 40, opaque, 3, GShader::kMirror);
+    auto translucent = GCreateSweepGradient({40, 20}, 1, clear, 3);
+    const GColorFilter fade = GColorFilter::Scale(1, 1, 1, 0.5f);
+
+    // the same translucent background in both, so kSrcOver has something to blend with
+    GPixelBuffer fast(64, 64), ref(64, 64);
+    for (const GPixelBuffer* device : { &fast, &ref }) {
+        GRandom rand(7);
+        visit_pixels(device->bitmap(), [&](int, int, GPixel* p) {
+            unsigned a = rand.nextRange(0, 0xFF);
+            *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), 0);
+        });
+    }
+    auto canvas = GCreateCanvas(fast.bitmap());
+    auto refCanvas = GCreateReferenceCanvas(ref.bitmap());
+
+    GPath path;
+    path.moveTo({2, 2}).lineTo({62, 10}).lineTo({40, 62}).lineTo({5, 50});
+    for (GShader* sh : { solid.get(), translucent.get() }) {
+        for (auto mode : { GBlendMode::kSrc, GBlendMode::kSrcOver }) {
+            for (const GColorFilter* filter : { (const GColorFilter*)nullptr, &fade }) {
+                GPaint paint(sh);
+                paint.setBlendMode(mode).setColorFilter(filter);
+                for (GCanvas* c : { canvas.get(), refCanvas.get() }) {
+                    c->drawPath(path, paint);
+                }
+            }
+        }
+    }
+    bool same = true;
+    for (int y = 0; y < 64; ++y) {
+        same &= !memcmp(fast->getAddr(0, y), ref->getAddr(0, y), 64 * sizeof(GPixel));
+    }
+    EXPECT_TRUE(stats, same);
+}
+
+static void test_canvas_area(GTestStats* stats) {
+    // shaders that step along the row, so a span shaded from the area's edge would come out
+    // differently from the whole span
+    const GColor colors[] = { {1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1} };
+    auto linear = GCreateLinearGradient({3, 7}, {29, 13}, colors, 3, GShader::kMirror);
+    auto radial = GCreateRadialGradient({40, 30}, 17, colors, 3, GShader::kRepeat);
+    GPixelBuffer src(8, 4);
+    GRandom rand(3);
+    visit_pixels(src.bitmap(), [&](int, int, GPixel* p) {
+        unsigned a = rand.nextRange(0, 255);
+        *p = GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+    });
+    auto bitmap = GCreateBitmapShader(src.bitmap(), GMatrix::Scale(0.3f, 0.3f), GShader::kRepeat,
+                                      GShader::kLinear_FilterMode);
+
+    auto draw = [&](GCanvas* canvas) {
+        canvas->clear({1, 1, 1, 1});
+        canvas->rotate(0.2f);
+        GPath path;
+        path.moveTo({2, -5}).lineTo({70, 8}).lineTo({50, 70}).lineTo({-4, 40});
+        for (GShader* sh : { linear.get(), radial.get(), bitmap.get() }) {
+            GPaint paint(sh);
+            paint.setBlendMode(sh == radial.get() ? GBlendMode::kSrcOver : GBlendMode::kSrc);
+            canvas->drawPath(path, paint);
+            canvas->drawRect(GRect::LTRB(10, 5, 60, 25), paint);
+            canvas->translate(3, 4);
+        }
+    };
+
+    GPixelBuffer full(64, 48);
+    draw(GCreateCanvas(full.bitmap()).get());
+
+    const GPixel kUntouched = GPixel_PackARGB(0xFF, 0x12, 0x34, 0x56);
+    for (const GIRect& area : { GIRect::LTRB(0, 0, 64, 48), GIRect::LTRB(13, 9, 37, 30),
+                                GIRect::LTRB(40, 0, 64, 17), GIRect::LTRB(5, 20, 6, 45) }) {
+        GPixelBuffer part(64, 48);
+        visit_pixels(part.bitmap(), [&](int, int, GPixel* p) { *p = kUntouched; });
+        draw(GCreateCanvas(part.bitmap(), area).get());
+
+        int wrong = 0;
+        visit_pixels(part.bitmap(), [&](int x, int y, GPixel* p) {
+            const bool inside = x >= area.left && x < area.right &&
+                                y >= area.top && y < area.bottom;
+            wrong += *p != (inside ? *full->getAddr(x, y) : kUntouched);
+        });
+        EXPECT_EQ(stats, wrong, 0);
+    }
+    EXPECT_TRUE(stats, !GCreateCanvas(full.bitmap(), GIRect::LTRB(-1, 0, 10, 10)));
+}
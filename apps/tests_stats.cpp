@@ -0,0 +1,85 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GCanvasStats.h"
+#include "../include/GShader.h"
+#include "../include/GTrace.h"
+#include "tests.h"
+#include <string>
+
+static void test_canvas_stats(GTestStats* stats) {
+    GPixelBuffer device(10, 10);
+    auto canvas = GCreateCanvas(device.bitmap());
+    const GCanvasStats* cs = canvas->getStats();
+    if (!cs) {
+        return;     // built without G_STATS
+    }
+    const int opaque = GCanvasStats::kOpaque_AlphaClass;
+    const int partial = GCanvasStats::kPartial_AlphaClass;
+
+    canvas->drawRect(GRect::LTRB(2, 2, 6, 5), GPaint(GColor::RGBA(1, 0, 0, 1)));
+    EXPECT_EQ(stats, (uint64_t)3, cs->fScanlines);
+    EXPECT_EQ(stats, (uint64_t)3, cs->fSpans);
+    EXPECT_EQ(stats, (uint64_t)12, cs->fBlitPixels[(int)GBlendMode::kSrcOver][opaque]);
+
+    canvas->resetStats();
+    EXPECT_EQ(stats, (uint64_t)0, cs->fSpans);
+
+    // a triangle hanging off the left edge: the diagonal is split into a pinned and an inside
+    // edge, the horizontal top covers no rows and is dropped before clipping
+    const GPoint pts[] = { {-5, 1}, {5, 1}, {5, 9} };
+    GPaint paint(GColor::RGBA(0, 0, 1, 0.5f));
+    paint.setBlendMode(GBlendMode::kSrc);
+    canvas->drawConvexPolygon(pts, 3, paint);
+    EXPECT_EQ(stats, (uint64_t)1, cs->fEdgesClipped);
+    EXPECT_EQ(stats, (uint64_t)3, cs->fEdgesBuilt);
+    EXPECT_EQ(stats, (uint64_t)8, cs->fScanlines);
+    EXPECT_TRUE(stats, cs->fBlitPixels[(int)GBlendMode::kSrc][partial] > 0);
+    EXPECT_EQ(stats, (uint64_t)0, cs->fBlitPixels[(int)GBlendMode::kSrcOver][partial]);
+
+    canvas->resetStats();
+    GPixel pixel = GPixel_PackARGB(0xFF, 0, 0xFF, 0);
+    GBitmap bm(1, 1, 4, &pixel, true);
+    auto shader = GCreateBitmapShader(bm, GMatrix());
+    canvas->drawRect(GRect::WH(10, 10), GPaint(shader.get()));
+    // every row samples the one texel row, so only the first is shaded and the rest reuse it
+    EXPECT_EQ(stats, (uint64_t)10, cs->fShadedPixels[GCanvasStats::kBitmap_ShaderType]);
+    EXPECT_EQ(stats, (uint64_t)100, cs->fBlitPixels[(int)GBlendMode::kSrcOver][opaque]);
+
+    // rotated, the rows differ and each is shaded
+    canvas->resetStats();
+    auto rotated = GCreateBitmapShader(bm, GMatrix::Rotate(0.5f));
+    canvas->drawRect(GRect::WH(10, 10), GPaint(rotated.get()));
+    EXPECT_EQ(stats, (uint64_t)100, cs->fShadedPixels[GCanvasStats::kBitmap_ShaderType]);
+}
+
+static void test_canvas_trace(GTestStats* stats) {
+    GPixelBuffer device(10, 10);
+    auto canvas = GCreateCanvas(device.bitmap());
+    const std::string path = temp_path("gtests_trace.json");
+
+    GTraceBegin();
+    canvas->drawRect(GRect::LTRB(2, 2, 6, 5), GPaint(GColor::RGBA(1, 0, 0, 1)));
+    EXPECT_TRUE(stats, GTraceEnd(path.c_str()));
+    // not recorded: tracing is off again
+    canvas->drawRect(GRect::WH(10, 10), GPaint(GColor::RGBA(1, 0, 0, 1)));
+
+    std::string json;
+    if (FILE* f = fopen(path.c_str(), "r")) {
+        char buffer[1024];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            json.append(buffer, n);
+        }
+        fclose(f);
+    }
+    remove(path.c_str());
+
+    EXPECT_TRUE(stats, json.find("\"name\": \"drawRect\"") != std::string::npos);
+    EXPECT_TRUE(stats, json.find("\"bounds\": [2, 2, 6, 5]") != std::string::npos);
+    EXPECT_TRUE(stats, json.find("\"pixels\": 12") != std::string::npos);
+    EXPECT_TRUE(stats, json.find("\"pixels\": 100") == std::string::npos);
+}
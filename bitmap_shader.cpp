@@ -8,29 +8,161 @@
 #include "include/GShader.h"
 #include "include/GPixel.h"
 #include "include/GPoint.h"
+#include "mipmap.h"
+#include "reference.h"
+#include "stats.h"
 #include "utils.h"
 
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/*
+ * Map a (possibly out of bounds) texel coordinate to a column/row of a bitmap of size max.
+ */
+template <GShader::TileMode> int tile_texel(float value, int max);
+
+template <> inline int tile_texel<GShader::kClamp>(float value, int max) {
+    return clamp_and_floor(value, max);
+}
+
+template <> inline int tile_texel<GShader::kRepeat>(float value, int max) {
+    int i = GFloorToInt(value) % max;
+    return i < 0 ? i + max : i;
+}
+
+template <> inline int tile_texel<GShader::kMirror>(float value, int max) {
+    int period = max << 1;
+    int i = GFloorToInt(value) % period;
+    if (i < 0) i += period;
+    return i < max ? i : period - 1 - i;
+}
+
+/*
+ * Same as tile_texel, for the integer texel indices of the bilinear filter. These are 64 bit,
+ * like the fixed point coordinates they come from.
+ */
+template <GShader::TileMode> int tile_index(int64_t i, int max);
+
+/*
+ * i mod m, in [0, m). A 64 bit divide is several times slower than a 32 bit one, and the
+ * indices nearly always fit in 32 bits.
+ */
+static inline int wrap_index(int64_t i, int m) {
+    int r = i == (int32_t) i ? (int32_t) i % m : (int) (i % m);
+    return r < 0 ? r + m : r;
+}
+
+template <> inline int tile_index<GShader::kClamp>(int64_t i, int max) {
+    return (int) std::max<int64_t>(0, std::min<int64_t>(i, max - 1));
+}
+
+template <> inline int tile_index<GShader::kRepeat>(int64_t i, int max) {
+    return wrap_index(i, max);
+}
+
+template <> inline int tile_index<GShader::kMirror>(int64_t i, int max) {
+    int period = max << 1;
+    int r = wrap_index(i, period);
+    return r < max ? r : period - 1 - r;
+}
+
+/*
+ * The tiled indices of texel i and its right (or bottom) neighbor i + 1.
+ */
+template <GShader::TileMode TM> inline void tile_pair(int64_t i, int max, int* i0, int* i1) {
+    *i0 = tile_index<TM>(i, max);
+    *i1 = tile_index<TM>(i + 1, max);
+}
+
+template <> inline void tile_pair<GShader::kRepeat>(int64_t i, int max, int* i0, int* i1) {
+    *i0 = tile_index<GShader::kRepeat>(i, max);
+    *i1 = *i0 + 1 < max ? *i0 + 1 : 0;
+}
+
+/*
+ * Bilinear sampling steps texel coordinates in 16.16 fixed point. The integer part picks the
+ * top-left texel of the 2x2 neighborhood and the top 8 bits of the fraction are the weight of
+ * the right/bottom texels.
+ *
+ * The values are 64 bit, so repeat and mirror tiling stay exact far from the bitmap. They are
+ * saturated to +/-2^24 texels, where a float has no fraction left anyway; a start and a step of
+ * at most 2^40 each then cannot overflow across any row shorter than 2^22 pixels.
+ */
+constexpr float kMaxFixedTexel = 16777216.0f;
+
+static inline int64_t to_fixed(float value) {
+    return (int64_t) (std::max(-kMaxFixedTexel, std::min(value, kMaxFixedTexel)) * 65536.0f);
+}
+
+/*
+ * (a * (256 - w) + b * w + 128) >> 8 on every channel. Each product fits in 16 bits, so two
+ * channels at a time can share a 32 bit register without carrying into each other.
+ */
+static inline GPixel lerp_pixel(GPixel a, GPixel b, unsigned w) {
+    const uint32_t mask = 0x00FF00FF;
+    const uint32_t half = 0x00800080;
+    uint32_t rb = ((a & mask) * (256 - w) + (b & mask) * w + half) >> 8;
+    uint32_t ag = ((a >> 8) & mask) * (256 - w) + ((b >> 8) & mask) * w + half;
+    return (rb & mask) | (ag & ~mask);
+}
+
+/*
+ * Blend the 2x2 neighborhood [tl tr / bl br] horizontally by wx and then vertically by wy.
+ */
+static inline GPixel bilerp(GPixel tl, GPixel tr, GPixel bl, GPixel br, unsigned wx, unsigned wy) {
+    return lerp_pixel(lerp_pixel(tl, tr, wx), lerp_pixel(bl, br, wx), wy);
+}
+
+#if defined(__SSE2__)
+/*
+ * lerp_pixel on 2 pixels unpacked to 16 bits per channel, w holds each pixel's weight 4 times.
+ */
+static inline __m128i lerp_16(__m128i a, __m128i b, __m128i w) {
+    const __m128i inv_w = _mm_sub_epi16(_mm_set1_epi16(256), w);
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, inv_w), _mm_mullo_epi16(b, w));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+/*
+ * bilerp on 4 pixels at once. The taps and weights are 4 lanes of 32 bits each.
+ */
+static inline __m128i bilerp_4(__m128i tl, __m128i tr, __m128i bl, __m128i br,
+                               __m128i wx, __m128i wy) {
+    const __m128i zero = _mm_setzero_si128();
+    // spread each pixel's weight over its 4 channels
+    wx = _mm_or_si128(wx, _mm_slli_epi32(wx, 16));
+    wy = _mm_or_si128(wy, _mm_slli_epi32(wy, 16));
+    const __m128i wx_lo = _mm_unpacklo_epi32(wx, wx), wx_hi = _mm_unpackhi_epi32(wx, wx);
+    const __m128i wy_lo = _mm_unpacklo_epi32(wy, wy), wy_hi = _mm_unpackhi_epi32(wy, wy);
+
+    __m128i top_lo = lerp_16(_mm_unpacklo_epi8(tl, zero), _mm_unpacklo_epi8(tr, zero), wx_lo);
+    __m128i top_hi = lerp_16(_mm_unpackhi_epi8(tl, zero), _mm_unpackhi_epi8(tr, zero), wx_hi);
+    __m128i bot_lo = lerp_16(_mm_unpacklo_epi8(bl, zero), _mm_unpacklo_epi8(br, zero), wx_lo);
+    __m128i bot_hi = lerp_16(_mm_unpackhi_epi8(bl, zero), _mm_unpackhi_epi8(br, zero), wx_hi);
+
+    return _mm_packus_epi16(lerp_16(top_lo, bot_lo, wy_lo), lerp_16(top_hi, bot_hi, wy_hi));
+}
+#endif
+
 class BitmapShader : public GShader {
 private:
     GBitmap fBitmap;
     GMatrix fLocInv;
     GMatrix fInverse;
-public:
-    BitmapShader(const GBitmap &bitmap, const GMatrix &localInverse) : fBitmap(bitmap), fLocInv(localInverse) {}
+    TileMode fTileMode;
+    FilterMode fFilterMode;
+    MipmapMode fMipmapMode;
 
-    bool isOpaque() override {
-        return this->fBitmap.isOpaque();
-    }
+    std::unique_ptr<Mipmap> fMipmap;    // created on the first minified setContext
+    GBitmap fLevel;                     // what the current context samples: fBitmap or a mip
 
-    bool setContext(const GMatrix &ctm) override {
-        return ctm.invert(&fInverse) && (fInverse = fLocInv * fInverse, true);
-    }
-
-    void shadeRow(int x, int y, int count, GPixel row[]) override {
-        if (fBitmap.width() <= 0 || fBitmap.height() <= 0) return;
+    template <TileMode TM> void shade(int x, int y, int count, GPixel row[]) {
+        const int width = fLevel.width();
+        const int height = fLevel.height();
 
         GPoint p = fInverse * GPoint{(float) x + 0.5f, (float) y + 0.5f};
-        int p_pr_x, p_pr_y;
+        int p_pr_x, p_pr_y = 0;
 
         /*
          * On transformations that are not rotations, we can observe an optimization that lifts
@@ -38,17 +170,17 @@ public:
          */
         bool y_compute = std::abs(fInverse[3]) > std::numeric_limits<float>::epsilon();
         if (!y_compute) {
-            p_pr_y = clamp_and_floor(p.y, fBitmap.height());
+            p_pr_y = tile_texel<TM>(p.y, height);
         }
 
         for (int i = 0; i < count; ++i) {
-            p_pr_x = clamp_and_floor(p.x, fBitmap.width());
+            p_pr_x = tile_texel<TM>(p.x, width);
 
             if (y_compute) {
-                p_pr_y = clamp_and_floor(p.y, fBitmap.height());
+                p_pr_y = tile_texel<TM>(p.y, height);
             }
 
-            row[i] = *fBitmap.getAddr(p_pr_x, p_pr_y);
+            row[i] = *fLevel.getAddr(p_pr_x, p_pr_y);
 
             p.x += fInverse[0];
 
@@ -58,10 +190,168 @@ public:
         }
     }
 
+    /*
+     * The 2x2 neighborhood of the texel coordinate (fx, fy), and the weights of its right and
+     * bottom texels.
+     */
+    template <TileMode TM> struct Taps {
+        const BitmapShader* shader;
+        const GPixel* row0;     // fixed rows when the sample y does not change along the row
+        const GPixel* row1;
+        unsigned wy;
+
+        void fetch(int64_t fx, int64_t fy, GPixel* tl, GPixel* tr, GPixel* bl, GPixel* br,
+                   unsigned* wx, unsigned* wy_out) const {
+            const GBitmap& bm = shader->fLevel;
+            int x0, x1;
+            tile_pair<TM>(fx >> 16, bm.width(), &x0, &x1);
+            const GPixel* r0 = row0;
+            const GPixel* r1 = row1;
+            *wy_out = wy;
+            if (!r0) {
+                int y0, y1;
+                tile_pair<TM>(fy >> 16, bm.height(), &y0, &y1);
+                r0 = bm.getAddr(0, y0);
+                r1 = bm.getAddr(0, y1);
+                *wy_out = (fy >> 8) & 0xFF;
+            }
+            *tl = r0[x0];
+            *tr = r0[x1];
+            *bl = r1[x0];
+            *br = r1[x1];
+            *wx = (fx >> 8) & 0xFF;
+        }
+    };
+
+    template <TileMode TM> void shade_linear(int x, int y, int count, GPixel row[]) {
+        // sample at the texel space position of the pixel center, relative to texel centers
+        GPoint p = fInverse * GPoint{(float) x + 0.5f, (float) y + 0.5f};
+        int64_t fx = to_fixed(p.x - 0.5f);
+        int64_t fy = to_fixed(p.y - 0.5f);
+        const int64_t dx = to_fixed(fInverse[0]);
+        const int64_t dy = to_fixed(fInverse[3]);
+
+        Taps<TM> taps = {this, nullptr, nullptr, 0};
+        if (dy == 0) {
+            int y0, y1;
+            tile_pair<TM>(fy >> 16, fLevel.height(), &y0, &y1);
+            taps.row0 = fLevel.getAddr(0, y0);
+            taps.row1 = fLevel.getAddr(0, y1);
+            taps.wy = (fy >> 8) & 0xFF;
+        }
+
+        int i = 0;
+#if defined(__SSE2__)
+        for (; !gReferenceBackend && i + 4 <= count; i += 4) {
+            GPixel tl[4], tr[4], bl[4], br[4];
+            unsigned wx[4], wy[4];
+            for (int k = 0; k < 4; ++k) {
+                taps.fetch(fx, fy, &tl[k], &tr[k], &bl[k], &br[k], &wx[k], &wy[k]);
+                fx += dx;
+                fy += dy;
+            }
+            // built in registers: storing the lanes and loading them back would stall on
+            // store forwarding
+            auto lanes = [](const uint32_t v[4]) {
+                return _mm_setr_epi32(v[0], v[1], v[2], v[3]);
+            };
+            __m128i result = bilerp_4(lanes(tl), lanes(tr), lanes(bl), lanes(br),
+                                      lanes(wx), lanes(wy));
+            _mm_storeu_si128((__m128i *) (row + i), result);
+        }
+#endif
+        for (; i < count; ++i) {
+            GPixel tl, tr, bl, br;
+            unsigned wx, wy;
+            taps.fetch(fx, fy, &tl, &tr, &bl, &br, &wx, &wy);
+            row[i] = bilerp(tl, tr, bl, br, wx, wy);
+            fx += dx;
+            fy += dy;
+        }
+    }
+
+public:
+    BitmapShader(const GBitmap &bitmap, const GMatrix &localInverse, TileMode tileMode,
+                 FilterMode filterMode, MipmapMode mipmapMode)
+            : fBitmap(bitmap), fLocInv(localInverse), fTileMode(tileMode),
+              fFilterMode(filterMode), fMipmapMode(mipmapMode), fLevel(bitmap) {}
+
+    bool isOpaque() override {
+        return this->fBitmap.isOpaque();
+    }
+
+    bool setContext(const GMatrix &ctm) override {
+        if (!ctm.invert(&fInverse)) return false;
+        fInverse = fLocInv * fInverse;
+        fLevel = fBitmap;
+
+        if (fMipmapMode == kNearest_MipmapMode) {
+            if (!fMipmap) {
+                fMipmap = std::make_unique<Mipmap>(fBitmap);
+            }
+            int level = fMipmap->choose_level(fInverse);
+            if (level > 0) {
+                fLevel = fMipmap->level(level);
+                fInverse = GMatrix::Scale((float) fLevel.width() / fBitmap.width(),
+                                          (float) fLevel.height() / fBitmap.height()) * fInverse;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Without rotation or skew (inv[1] == inv[3] == 0), x and y sample independently: a row's
+     * texels depend on y only through the (tiled) texel row it samples, or for the bilinear
+     * filter through the fixed point y that picks both rows and their weight.
+     */
+    RowInvariance rowInvariance() override {
+        if (fLevel.width() <= 0 || fLevel.height() <= 0) return kNone_RowInvariance;
+        return fInverse[1] == 0 && fInverse[3] == 0 ? kKeyed_RowInvariance
+                                                    : kNone_RowInvariance;
+    }
+
+    int64_t rowKey(int y) override {
+        // the same p.y that shade() and shade_linear() start from, whatever their x
+        const float py = (fInverse * GPoint{0.5f, (float) y + 0.5f}).y;
+        if (fFilterMode == kLinear_FilterMode) {
+            return to_fixed(py - 0.5f) >> 8;
+        }
+        switch (fTileMode) {
+            case kClamp:  return tile_texel<kClamp>(py, fLevel.height());
+            case kRepeat: return tile_texel<kRepeat>(py, fLevel.height());
+            case kMirror: return tile_texel<kMirror>(py, fLevel.height());
+        }
+        return y;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        if (fLevel.width() <= 0 || fLevel.height() <= 0) return;
+        G_STAT_ADD(fShadedPixels[GCanvasStats::kBitmap_ShaderType], count);
+
+        if (fFilterMode == kLinear_FilterMode) {
+            switch (fTileMode) {
+                case kClamp:  this->shade_linear<kClamp>(x, y, count, row);  break;
+                case kRepeat: this->shade_linear<kRepeat>(x, y, count, row); break;
+                case kMirror: this->shade_linear<kMirror>(x, y, count, row); break;
+            }
+            return;
+        }
+
+        switch (fTileMode) {
+            case kClamp:  this->shade<kClamp>(x, y, count, row);  break;
+            case kRepeat: this->shade<kRepeat>(x, y, count, row); break;
+            case kMirror: this->shade<kMirror>(x, y, count, row); break;
+        }
+    }
+
 };
 
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap &bitmap,
-                                             const GMatrix &localInverse) {
+                                             const GMatrix &localInverse,
+                                             GShader::TileMode tileMode,
+                                             GShader::FilterMode filterMode,
+                                             GShader::MipmapMode mipmapMode) {
     if (!bitmap.pixels()) return nullptr;
-    return std::make_unique<BitmapShader>(bitmap, localInverse);
+    return std::make_unique<BitmapShader>(bitmap, localInverse, tileMode, filterMode,
+                                          mipmapMode);
 }
@@ -7,47 +7,136 @@
 #include "include/GShader.h"
 #include "blitter.h"
 #include "blends.h"
+#include "color_filter.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
 
-Blit::Blit(const GBitmap& bitmap, const GRect& bounds, const GPaint& paint)
-        : fDevice(bitmap), fBounds(bounds), fPaint(paint) {
-    fBuffer = new GPixel[fDevice.width()];  // Allocate buffer based on the bitmap width
-    (void) fBounds;
+Blit::Blit(const GBitmap& bitmap, const GIRect& area, const GPaint& paint)
+        : fDevice(bitmap), fArea(area), fPaint(paint) {
+    GShader *shader = paint.getShader();
+    fRowInvariance = shader ? shader->rowInvariance() : GShader::kNone_RowInvariance;
+
+    // a filter can turn opaque pixels translucent; in kSrc that does not matter, since the src
+    // replaces the dst whatever its alpha (a transparent premul pixel is 0, which kSrc writes)
+    const GBlendMode mode = paint.getBlendMode();
+    fWriteThrough = shader && (mode == GBlendMode::kSrc ||
+                               (mode == GBlendMode::kSrcOver && shader->isOpaque() &&
+                                !paint.getColorFilter()));
 }
 
 Blit::~Blit() {
     delete[] fBuffer;  // Deallocate the buffer
 }
 
+GPixel* Blit::buffer() {
+    if (!fBuffer) {
+        fBuffer = new GPixel[fDevice.width()];  // Allocate buffer based on the bitmap width
+    }
+    return fBuffer;
+}
+
 void Blit::blit_horizontal(float x_left, float x_right, int y) {
-    if (y < 0 || y >= this->fDevice.height()) return;
+    if (y < this->fArea.top || y >= this->fArea.bottom) return;
 
+    // The span as a canvas over the whole device sees it, which is what the shader is asked for:
+    // its pixels depend on where the span starts. Only [w_left, w_right) of it is written.
     int x_l_int = std::max(GRoundToInt(x_left), 0);
     int x_r_int = std::min(GRoundToInt(x_right), this->fDevice.width());
+    int w_left = std::max(x_l_int, this->fArea.left);
+    int w_right = std::min(x_r_int, this->fArea.right);
+
+    if (w_left >= w_right) return;
 
-    if (x_l_int >= x_r_int) return;
+    TraceSampledTimer trace(kBlit_Phase);
+    if (gTraceEvent) trace_pixels(w_left, y, w_right, y + 1);
 
     GShader *shader = this->fPaint.getShader();
+    const int count = w_right - w_left;
 
     if (!shader) {
-        GPixel src = color_to_pixel(this->fPaint.getColor());
+        GPixel src = color_to_pixel(paint_color(this->fPaint));
         BlendFuncPtr blend = blend_func(this->fPaint.getBlendMode(),    src);
+        G_STAT_BLIT_SOLID(this->fPaint.getBlendMode(), src, count);
 
-        for (int i = x_l_int; i < x_r_int; ++i) {
+        for (int i = w_left; i < w_right; ++i) {
             GPixel *dst = this->fDevice.getAddr(i, y);
             *dst = blend(*dst, src);
         }
-    } else {
-        int count = x_r_int - x_l_int;
-        shader->shadeRow(x_l_int, y, count, fBuffer);
+    } else if (fRowInvariance == GShader::kConstantX_RowInvariance) {
+        // one color for the whole row: shade a single pixel, and then it is a solid fill
+        GPixel src;
+        shader->shadeRow(x_l_int, y, 1, &src);
+        if (this->fPaint.getColorFilter()) {
+            filter_row(*this->fPaint.getColorFilter(), &src, 1);
+        }
+        GBlendMode mode = this->fPaint.getBlendMode();
+        G_STAT_BLIT_SOLID(mode, src, count);
 
-        BlendFuncPtr blend;
+        GPixel *dst = this->fDevice.getAddr(w_left, y);
+        if (blend_func(mode, src) == srcBlend) {
+            std::fill(dst, dst + count, src);
+        } else {
+            BlendFuncPtr blend = blend_func(mode, src);
+            for (int i = w_left; i < w_right; ++i, ++dst) {
+                *dst = blend(*dst, src);
+            }
+        }
+    } else if (fWriteThrough && fRowInvariance == GShader::kNone_RowInvariance &&
+               w_left == x_l_int && w_right == x_r_int) {
         GPixel *dst = this->fDevice.getAddr(x_l_int, y);
-        GPixel *src_pixel = fBuffer;
+        shader->shadeRow(x_l_int, y, count, dst);
+        if (this->fPaint.getColorFilter()) {
+            filter_row(*this->fPaint.getColorFilter(), dst, count);
+        }
+        G_STAT_BLIT_ROW(this->fPaint.getBlendMode(), dst, count);
+    } else {
+        const GPixel *src = this->shade(x_l_int, x_r_int, y) + (w_left - x_l_int);
+        GBlendMode mode = this->fPaint.getBlendMode();
+        G_STAT_BLIT_ROW(mode, src, count);
+
+        GPixel *dst = this->fDevice.getAddr(w_left, y);
+        if (fWriteThrough) {
+            // a cached row, or one shaded wider than the area, copied in
+            memcpy(dst, src, count * sizeof(GPixel));
+            return;
+        }
 
-        for (int i = x_l_int; i < x_r_int; ++i, ++dst, ++src_pixel) {
-            blend = blend_func(this->fPaint.getBlendMode(), *src_pixel);
-            *dst = blend(*dst, *src_pixel);
+        BlendFuncPtr blend;
+        for (int i = w_left; i < w_right; ++i, ++dst, ++src) {
+            blend = blend_func(mode, *src);
+            *dst = blend(*dst, *src);
         }
     }
 }
+
+/*
+ * The shaded (and filtered) pixels of [x_left, x_right) on row y. Rows that repeat come from
+ * the cache in fBuffer when they can: a row's pixels depend on where it starts (shaders step
+ * along the row), so only a span starting at the same x, and no longer, is reused.
+ */
+const GPixel* Blit::shade(int x_left, int x_right, int y) {
+    GShader *shader = this->fPaint.getShader();
+    const int count = x_right - x_left;
+
+    int64_t key = 0;
+    switch (fRowInvariance) {
+        case GShader::kConstantY_RowInvariance: key = 0;                  break;
+        case GShader::kKeyed_RowInvariance:     key = shader->rowKey(y);  break;
+        default:                                fCached = false;          break;
+    }
+    if (fCached && key == fCacheKey && x_left == fCacheLeft && x_right <= fCacheRight) {
+        return fBuffer;
+    }
+
+    GPixel *row = this->buffer();
+    shader->shadeRow(x_left, y, count, row);
+    if (this->fPaint.getColorFilter()) {
+        filter_row(*this->fPaint.getColorFilter(), row, count);
+    }
+    fCached = fRowInvariance != GShader::kNone_RowInvariance;
+    fCacheKey = key;
+    fCacheLeft = x_left;
+    fCacheRight = x_right;
+    return fBuffer;
+}
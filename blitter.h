@@ -8,18 +8,35 @@
 #include "include/GBitmap.h"
 #include "include/GRect.h"
 #include "include/GPaint.h"
+#include "include/GShader.h"
 
 class Blit {
 private:
     const GBitmap fDevice;
-    const GRect fBounds;
+    const GIRect fArea;  // the device pixels it may write; spans are shaded whole, written clipped
     const GPaint fPaint;
-    GPixel* fBuffer;  // pre-allocated buffer
+    GPixel* fBuffer = nullptr;  // a row of shaded pixels, allocated on first use (see buffer())
+
+    // When the shader's rows repeat (see GShader::rowInvariance), fBuffer doubles as a cache of
+    // the last row shaded: its key, and the span it covers.
+    GShader::RowInvariance fRowInvariance;
+    bool fCached = false;
+    int64_t fCacheKey = 0;
+    int fCacheLeft = 0, fCacheRight = 0;
+
+    // Shade straight into the device row, with no buffer and no blend pass: the shaded pixels
+    // replace the dst, as in kSrc, or kSrcOver with an opaque shader.
+    bool fWriteThrough;
+
+    GPixel* buffer();
+    const GPixel* shade(int x_left, int x_right, int y);
 
 public:
-    Blit(const GBitmap&, const GRect&, const GPaint&);
+    Blit(const GBitmap&, const GIRect& area, const GPaint&);
     ~Blit();
     void blit_horizontal(float x_left, float x_right, int y);
+    // the reference backend's blit, see reference.h
+    void blit_reference(float x_left, float x_right, int y);
 };
 
 #endif
@@ -18,15 +18,42 @@
 #include "edge.h"
 #include "blends.h"
 #include "clip.h"
+#include "curves.h"
+#include "reference.h"
 #include "scan_converter.h"
+#include "stats.h"
+#include "trace.h"
+
+#ifdef G_STATS
+thread_local GCanvasStats* gStats = nullptr;
+#endif
 
 class OtherCanvas : public GCanvas {
 private:
     const GBitmap fDevice;
     GRect fBounds{};
+    const GIRect fArea;     // the pixels draws may write; geometry is still clipped to fBounds
     std::stack<GMatrix> CTMStack;
+    GCanvasStats fStats;
+    const bool fReference;  // draw with the reference backend, see reference.h
+
+    void scan_rect(GIRect& rect, Blit& blit) const {
+        if (fReference) ReferenceScanConverter::scan_rect(rect, blit);
+        else ScanConverter::scan_rect(rect, blit);
+    }
+
+    void scan_convex(Edge* edges, int count, Blit& blit) const {
+        if (fReference) ReferenceScanConverter::scan_convex(edges, count, blit);
+        else ScanConverter::scan_convex(edges, count, blit);
+    }
+
+    void scan_complex(Edge* edges, int count, Blit& blit) const {
+        if (fReference) ReferenceScanConverter::scan_complex(edges, count, blit);
+        else ScanConverter::scan_complex(edges, count, blit);
+    }
 public:
-    explicit OtherCanvas(const GBitmap &device) : fDevice(device) {
+    OtherCanvas(const GBitmap &device, const GIRect &area, bool reference = false)
+            : fDevice(device), fArea(area), fReference(reference) {
         fBounds = GRect::LTRB(0,
                               0,
                               static_cast<int>(device.width()),
@@ -35,14 +62,13 @@ public:
     }
 
     void clear(const GColor &color) override {
+        TraceScope trace("clear");
         GPixel src = color_to_pixel(color);
+        if (gTraceEvent) trace_pixels(fArea.left, fArea.top, fArea.right, fArea.bottom);
 
-        int height = fDevice.height();
-        int width = fDevice.width();
-
-        for (int y = 0; y < height; ++y) {
-            GPixel* row_start = fDevice.getAddr(0, y);
-            GPixel* row_end = row_start + width;
+        for (int y = fArea.top; y < fArea.bottom; ++y) {
+            GPixel* row_start = fDevice.getAddr(fArea.left, y);
+            GPixel* row_end = row_start + fArea.width();
 
             for (GPixel* addr = row_start; addr < row_end; ++addr) {
                 *addr = src;
@@ -51,6 +77,9 @@ public:
     }
 
     void drawConvexPolygon(const GPoint src_points[], int count, const GPaint &paint) override {
+        StatsScope stats(&fStats);
+        TraceScope trace("drawConvexPolygon");
+        ReferenceScope backend(fReference);
         if (count < 3) return;
         if (null_draw(paint)) return;
         if (paint.getShader() && !paint.getShader()->setContext(this->CTMStack.top())) return;
@@ -76,52 +105,92 @@ public:
 //        }
 
         GPoint points[count];
-        this->CTMStack.top().mapPoints(points, src_points, count);
+        {
+            TracePhaseTimer phase(kTransform_Phase);
+            this->CTMStack.top().mapPoints(points, src_points, count);
+        }
 
         Edge *edges;
         int edge_count;
 
-        Clipper clipper = Clipper(this->fBounds);
-        clipper.batch_clip(points, count, &edges, edge_count);
-
-        if (edge_count < 2) return;
+        {
+            TracePhaseTimer phase(kClip_Phase);
+            Clipper clipper = Clipper(this->fBounds);
+            clipper.batch_clip(points, count, &edges, edge_count);
+        }
+        trace_counts(count, edge_count);
 
-        Blit blit = Blit(this->fDevice, this->fBounds, paint);
+        if (edge_count >= 2) {
+            Blit blit = Blit(this->fDevice, this->fArea, paint);
 
-        ScanConverter::scan_convex(edges, edge_count, blit);
+            TracePhaseTimer phase(kScan_Phase);
+            this->scan_convex(edges, edge_count, blit);
+        }
 
         delete[] edges;
     }
 
     void drawPath(const GPath& path, const GPaint& paint) override {
+        StatsScope stats(&fStats);
+        TraceScope trace("drawPath");
+        ReferenceScope backend(fReference);
         if (path.countPoints() < 3) return;
         if (null_draw(paint)) return;
         if (paint.getShader() && !paint.getShader()->setContext(this->CTMStack.top())) return;
 
         GPath transformed = path;
-        transformed.transform(this->CTMStack.top());
+        {
+            TracePhaseTimer phase(kTransform_Phase);
+            transformed.transform(this->CTMStack.top());
+        }
         int path_count = transformed.countPoints();
 
-        GPath::Edger edger = GPath::Edger(transformed);
+        GPoint pts[GPath::kMaxNextPoints];
         GPath::Verb verb;
 
-        GPoint pts_list[path_count << 1];
-        int tw_idx = 0;
-
-        do {
-            verb = edger.next(&pts_list[tw_idx << 1]);
-            if (verb == GPath::Verb::kLine)
-                tw_idx++;
-        } while (verb != GPath::Verb::kDone);
-
-        Edge *edges;
-        int edge_count;
+        // curves are flattened to lines, count them first to size the edge buffer
+        int segments = 0;
+        GPath::Edger counter(transformed);
+        while ((verb = counter.next(pts)) != GPath::kDone) {
+            switch (verb) {
+                case GPath::kQuad:  segments += quad_segments(pts);  break;
+                case GPath::kCubic: segments += cubic_segments(pts); break;
+                default:            segments += 1;                   break;
+            }
+        }
 
-        Clipper clipper = Clipper(this->fBounds);
-        clipper.batch_clip(pts_list, tw_idx, &edges, edge_count);
+        // each segment clips to at most 3 edges
+        Edge *edges = new Edge[segments * 3];
+        int edge_count = 0;
+
+        {
+            TracePhaseTimer phase(kClip_Phase);
+            Clipper clipper = Clipper(this->fBounds);
+            GPath::Edger edger(transformed);
+            while ((verb = edger.next(pts)) != GPath::kDone) {
+                if (verb == GPath::kLine) {
+                    clipper.clip_segment(pts[0], pts[1], edges, edge_count);
+                    continue;
+                }
+                int n = verb == GPath::kQuad ? quad_segments(pts) : cubic_segments(pts);
+                const GPoint& end = pts[verb == GPath::kQuad ? 2 : 3];
+                GPoint prev = pts[0];
+                for (int i = 1; i <= n; ++i) {
+                    float t = (float) i / n;
+                    GPoint next = i == n ? end : verb == GPath::kQuad ? eval_quad(pts, t)
+                                                                      : eval_cubic(pts, t);
+                    clipper.clip_segment(prev, next, edges, edge_count);
+                    prev = next;
+                }
+            }
+        }
+        trace_counts(path_count, edge_count);
 
-        Blit blit = Blit(this->fDevice, this->fBounds, paint);
-        ScanConverter::scan_complex(edges, edge_count, blit);
+        Blit blit = Blit(this->fDevice, this->fArea, paint);
+        {
+            TracePhaseTimer phase(kScan_Phase);
+            this->scan_complex(edges, edge_count, blit);
+        }
 
         delete[] edges;
     }
@@ -131,6 +200,9 @@ public:
      * Draw a rectangular area by filling it with the provided paint.
      */
     void drawRect(const GRect &rect, const GPaint &paint) override {
+        StatsScope stats(&fStats);
+        TraceScope trace("drawRect");
+        ReferenceScope backend(fReference);
         if (null_draw(paint)) return;
         if (paint.getShader() && !paint.getShader()->setContext(this->CTMStack.top())) return;
 
@@ -143,13 +215,18 @@ public:
             };
 
             GPoint new_pts[4];
-            this->CTMStack.top().mapPoints(new_pts, pts, 4);
+            {
+                TracePhaseTimer phase(kTransform_Phase);
+                this->CTMStack.top().mapPoints(new_pts, pts, 4);
+            }
 
             GIRect r_rect = rect_from_points(new_pts);
             r_rect = clip_to_bounds(r_rect, fBounds);
+            trace_counts(4, 0);
 
-            Blit blit(this->fDevice, this->fBounds, paint);
-            ScanConverter::scan_rect(r_rect, blit);
+            Blit blit(this->fDevice, this->fArea, paint);
+            TracePhaseTimer phase(kScan_Phase);
+            this->scan_rect(r_rect, blit);
             return;
         }
 
@@ -178,10 +255,32 @@ public:
     void concat(const GMatrix &matrix) override {
         this->CTMStack.top() = this->CTMStack.top() * matrix;
     }
+
+#ifdef G_STATS
+    const GCanvasStats* getStats() const override {
+        return &fStats;
+    }
+
+    void resetStats() override {
+        fStats.reset();
+    }
+#endif
 };
 
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap &device) {
-    return std::make_unique<OtherCanvas>(device);
+    return std::make_unique<OtherCanvas>(device, GIRect::WH(device.width(), device.height()));
+}
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap &device, const GIRect &area) {
+    if (area.left < 0 || area.top < 0 ||
+        area.right > device.width() || area.bottom > device.height()) {
+        return nullptr;
+    }
+    return std::make_unique<OtherCanvas>(device, area);
+}
+
+std::unique_ptr<GCanvas> GCreateReferenceCanvas(const GBitmap &device) {
+    return std::make_unique<OtherCanvas>(device, GIRect::WH(device.width(), device.height()), true);
 }
 
 std::string GDrawSomething(GCanvas *canvas, GISize size) {
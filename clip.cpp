@@ -10,8 +10,9 @@
 #include "include/GRect.h"
 #include "clip.h"
 #include "edge.h"
+#include "stats.h"
 
-Clipper::Clipper(const GIRect& bounds) : fBounds(bounds) {}
+Clipper::Clipper(const GRect& bounds) : fBounds(bounds) {}
 
 u_int8_t Clipper::compute_bounds_code(GPoint point) {
     bool left = point.x < this->fBounds.left;
@@ -38,7 +39,8 @@ u_int8_t Clipper::compute_bounds_code(GPoint point) {
 void Clipper::batch_clip(const GPoint* points, int count, Edge** out, int& out_count) {
     assert(count >= 3);
 
-    *out = new Edge[count + (count >> 1)];
+    // each segment clips to at most 3 edges: pinned left, inside, pinned right
+    *out = new Edge[count * 3];
     out_count = 0;
 
     // up to almost last
@@ -57,6 +59,24 @@ void Clipper::batch_clip(const GPoint* points, int count, Edge** out, int& out_c
     int r_p1_y = GRoundToInt(p1.y);
     if (r_p0_y != r_p1_y)
         this->clip_points(p0, p1, out, out_count);
+
+    G_STAT_ADD(fEdgesBuilt, out_count);
+}
+
+void Clipper::clip_segment(GPoint p0, GPoint p1, Edge* out, int& out_count) {
+    if (GRoundToInt(p0.y) == GRoundToInt(p1.y)) return;
+
+    [[maybe_unused]] int before = out_count;
+    this->clip_points(p0, p1, &out, out_count);
+    G_STAT_ADD(fEdgesBuilt, out_count - before);
+}
+
+/*
+ * Append the edge p0 -> p1 unless it covers no pixel centers.
+ */
+static inline void append_edge(GPoint p0, GPoint p1, int wind, Edge* out, int &out_count) {
+    if (GRoundToInt(p0.y) == GRoundToInt(p1.y)) return;
+    out[out_count++] = make_edge(p0, p1, wind);
 }
 
 void Clipper::clip_points(GPoint &p0, GPoint &p1, Edge** out, int &out_count) {
@@ -70,55 +90,57 @@ void Clipper::clip_points(GPoint &p0, GPoint &p1, Edge** out, int &out_count) {
     u_int8_t p0_flag = this->compute_bounds_code(p0);
     u_int8_t p1_flag = this->compute_bounds_code(p1);
 
-    // If either endpoint is entirely out of bounds vertically, exit early
-    if (p1_flag == TOP || p0_flag == BOTTOM) {
+    // Trivially inside
+    if ((p0_flag | p1_flag) == IN) {
+        append_edge(p0, p1, wind, *out, out_count);
         return;
     }
+    G_STAT_ADD(fEdgesClipped, 1);
 
-    float dx = p1.x - p0.x;
-    float dy = p1.y - p0.y;
+    // If the segment is entirely above or below the bounds, exit early
+    if (p1.y <= fBounds.top || p0.y >= fBounds.bottom) {
+        return;
+    }
 
-    // Adjust p0 if it's above the top bound
+    // Chop to the top and bottom bounds
     if (p0_flag & TOP) {
-        float x_new = p0.x + dx * (fBounds.top - p0.y) / dy;
-        p0 = {x_new, fBounds.top};
+        p0 = {p0.x + (p1.x - p0.x) * (fBounds.top - p0.y) / (p1.y - p0.y), fBounds.top};
     }
-
-    // Adjust p1 if it's below the bottom bound
     if (p1_flag & BOTTOM) {
-        float x_new = p1.x - dx * (p1.y - fBounds.bottom) / dy;
-        p1 = {x_new, fBounds.bottom};
+        p1 = {p1.x - (p1.x - p0.x) * (p1.y - fBounds.bottom) / (p1.y - p0.y), fBounds.bottom};
     }
 
-    // Sort points based on x-coordinate
+    // Sort points based on x-coordinate (the winding was already taken from y)
     if (p0.x > p1.x) {
         std::swap(p0, p1);
     }
 
-    // Handle left and right bounds
-    if (p1_flag & LEFT) {
-        out[out_count++] = make_edge({fBounds.left, p0.y}, {fBounds.left, p1.y}, wind);
+    // Entirely to the left or right: pin to that side
+    if (p1.x <= fBounds.left) {
+        append_edge({fBounds.left, p0.y}, {fBounds.left, p1.y}, wind, *out, out_count);
         return;
     }
-    if (p0_flag & RIGHT) {
-        out[out_count++] = make_edge({fBounds.right, p0.y}, {fBounds.right, p1.y}, wind);
+    if (p0.x >= fBounds.right) {
+        append_edge({fBounds.right, p0.y}, {fBounds.right, p1.y}, wind, *out, out_count);
         return;
     }
 
-    // Adjust p0 if it's to the left of the left bound
-    if (p0_flag & LEFT) {
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+
+    // Pin the part left of the left bound to it
+    if (p0.x < fBounds.left) {
         float y_new = p0.y + dy * (fBounds.left - p0.x) / dx;
-        out[out_count++] = make_edge({fBounds.left, p0.y}, {fBounds.left, y_new}, wind);
+        append_edge({fBounds.left, p0.y}, {fBounds.left, y_new}, wind, *out, out_count);
         p0 = {fBounds.left, y_new};
     }
 
-    // Adjust p1 if it's to the right of the right bound
-    if (p1_flag & RIGHT) {
+    // Pin the part right of the right bound to it
+    if (p1.x > fBounds.right) {
         float y_new = p1.y - dy * (p1.x - fBounds.right) / dx;
-        out[out_count++] = make_edge({fBounds.right, y_new}, {fBounds.right, p1.y}, wind);
+        append_edge({fBounds.right, y_new}, {fBounds.right, p1.y}, wind, *out, out_count);
         p1 = {fBounds.right, y_new};
     }
 
-    (*out)[out_count++] = make_edge({fBounds.left, p0.y}, {fBounds.left, p1.y}, wind);
-
+    append_edge(p0, p1, wind, *out, out_count);
 }
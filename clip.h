@@ -25,15 +25,18 @@ const u_int8_t BRC = BOTTOM | RIGHT | CORNER;
 
 class Clipper {
 private:
-    const GIRect &fBounds;
+    const GRect &fBounds;
 protected:
     void clip_points(GPoint &, GPoint &, Edge**, int &);
 public:
-    Clipper(const GIRect &);
+    Clipper(const GRect &);
 
     u_int8_t compute_bounds_code(GPoint);
 
     void batch_clip(const GPoint *, int, Edge**, int &);
+
+    // Clip the segment p0 -> p1, appending its (at most 3) edges to out.
+    void clip_segment(GPoint, GPoint, Edge*, int &);
 };
 
 
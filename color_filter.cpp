@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "include/GColorFilter.h"
+#include "include/GPixel.h"
+#include "color_filter.h"
+#include "reference.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+GColorFilter::GColorFilter(const float matrix[20]) {
+    memcpy(fMatrix, matrix, sizeof(fMatrix));
+
+    fIsScale = true;
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 5; ++col) {
+            const float m = fMatrix[row * 5 + col];
+            fIsScale &= row == col ? m >= 0 && m <= 1 : m == 0;
+        }
+    }
+}
+
+GColorFilter GColorFilter::Scale(float r, float g, float b, float a) {
+    const float matrix[20] = {
+        r, 0, 0, 0, 0,
+        0, g, 0, 0, 0,
+        0, 0, b, 0, 0,
+        0, 0, 0, a, 0,
+    };
+    return GColorFilter(matrix);
+}
+
+GColor GColorFilter::filterColor(const GColor& color) const {
+    const GColor c = color.pinToUnit();
+    const float* m = fMatrix;
+    return GColor::RGBA(m[ 0]*c.r + m[ 1]*c.g + m[ 2]*c.b + m[ 3]*c.a + m[ 4],
+                        m[ 5]*c.r + m[ 6]*c.g + m[ 7]*c.b + m[ 8]*c.a + m[ 9],
+                        m[10]*c.r + m[11]*c.g + m[12]*c.b + m[13]*c.a + m[14],
+                        m[15]*c.r + m[16]*c.g + m[17]*c.b + m[18]*c.a + m[19]).pinToUnit();
+}
+
+static inline unsigned to_byte(float v) {
+    return (unsigned)(v + 0.5f);
+}
+
+static inline float pin_unit(float v) {
+    return std::min(std::max(v, 0.0f), 1.0f);
+}
+
+/*
+ * Scale, on premul pixels: scaling the unpremul channels by s and alpha by sa scales the premul
+ * ones by s * sa. With every factor in [0, 1] nothing can leave its range, so there is no pin.
+ */
+static void scale_row(const float k[4], GPixel row[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    if (!gReferenceBackend) {
+        // lanes in memory order: b, g, r, a
+        const __m128 vk = _mm_setr_ps(k[2], k[1], k[0], k[3]);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 2 <= count; i += 2) {
+            const __m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row + i)), zero);
+            const __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(px, zero));
+            const __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(px, zero));
+            const __m128i out = _mm_packs_epi32(
+                    _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lo, vk), half)),
+                    _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(hi, vk), half)));
+            _mm_storel_epi64((__m128i*)(row + i), _mm_packus_epi16(out, out));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const GPixel p = row[i];
+        row[i] = GPixel_PackARGB(to_byte((float)GPixel_GetA(p) * k[3]),
+                                 to_byte((float)GPixel_GetR(p) * k[0]),
+                                 to_byte((float)GPixel_GetG(p) * k[1]),
+                                 to_byte((float)GPixel_GetB(p) * k[2]));
+    }
+}
+
+/*
+ * The full matrix: unpremul into [0, 1], multiply, pin, and premul again.
+ */
+static void matrix_row(const float m[20], GPixel row[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    if (!gReferenceBackend) {
+        // column c of the matrix, as lanes in memory order: b, g, r, a
+        auto column = [m](int c) {
+            return _mm_setr_ps(m[10 + c], m[5 + c], m[c], m[15 + c]);
+        };
+        const __m128 cr = column(0), cg = column(1), cb = column(2), ca = column(3);
+        const __m128 ct = column(4);
+        const __m128 zero_ps = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128 k255 = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; i < count; ++i) {
+            const unsigned a = GPixel_GetA(row[i]);
+            const float inv = a ? 1.0f / (float)a : 0.0f;
+            const __m128i px = _mm_unpacklo_epi16(
+                    _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)row[i]), zero), zero);
+            const __m128 c = _mm_mul_ps(_mm_cvtepi32_ps(px),
+                                        _mm_setr_ps(inv, inv, inv, 1.0f / 255));
+
+            __m128 v = _mm_mul_ps(cr, _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)));
+            v = _mm_add_ps(v, _mm_mul_ps(cg, _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1))));
+            v = _mm_add_ps(v, _mm_mul_ps(cb, _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0))));
+            v = _mm_add_ps(v, _mm_mul_ps(ca, _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3))));
+            v = _mm_add_ps(v, ct);
+            v = _mm_min_ps(_mm_max_ps(v, zero_ps), one);
+
+            // premul: multiply by (a, a, a, 1), so alpha itself is left alone
+            const __m128 va = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+            v = _mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(va, _mm_setr_ps(1, 1, 1, 0)),
+                                         _mm_setr_ps(0, 0, 0, 1)));
+            v = _mm_add_ps(_mm_mul_ps(v, k255), half);
+            const __m128i out = _mm_packs_epi32(_mm_cvttps_epi32(v), zero);
+            row[i] = (GPixel)_mm_cvtsi128_si32(_mm_packus_epi16(out, zero));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const GPixel p = row[i];
+        const unsigned a = GPixel_GetA(p);
+        const float inv = a ? 1.0f / (float)a : 0.0f;
+        const float r = (float)GPixel_GetR(p) * inv;
+        const float g = (float)GPixel_GetG(p) * inv;
+        const float b = (float)GPixel_GetB(p) * inv;
+        const float fa = (float)a * (1.0f / 255);
+
+        float out[4];
+        for (int j = 0; j < 4; ++j) {
+            const float* mj = m + j * 5;
+            out[j] = pin_unit(mj[0] * r + mj[1] * g + mj[2] * b + mj[3] * fa + mj[4]);
+        }
+        row[i] = GPixel_PackARGB(to_byte(out[3] * 255.0f),
+                                 to_byte(out[0] * out[3] * 255.0f),
+                                 to_byte(out[1] * out[3] * 255.0f),
+                                 to_byte(out[2] * out[3] * 255.0f));
+    }
+}
+
+void filter_row(const GColorFilter& filter, GPixel row[], int count) {
+    const float* m = filter.matrix();
+    if (filter.isScale()) {
+        const float k[4] = { m[0] * m[18], m[6] * m[18], m[12] * m[18], m[18] };
+        scale_row(k, row, count);
+    } else {
+        matrix_row(m, row, count);
+    }
+}
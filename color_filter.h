@@ -0,0 +1,17 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef COLOR_FILTER_H_
+#define COLOR_FILTER_H_
+
+#include "include/GColorFilter.h"
+#include "include/GPixel.h"
+
+/*
+ * Filter a row of premul pixels in place (Blit calls this between shadeRow and blending). The
+ * vector and scalar loops do the same float ops, so the backends agree to the bit.
+ */
+void filter_row(const GColorFilter&, GPixel row[], int count);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "include/GMatrix.h"
+#include "include/GShader.h"
+#include "include/GPixel.h"
+#include "blends.h"
+#include "utils.h"
+
+/*
+ * Whether mode(dst, src) is always opaque, given which of the two are.
+ */
+static bool blend_is_opaque(GBlendMode mode, bool dst, bool src) {
+    switch (mode) {
+        case GBlendMode::kSrc:
+        case GBlendMode::kDstATop:  return src;
+        case GBlendMode::kDst:
+        case GBlendMode::kSrcATop:  return dst;
+        case GBlendMode::kSrcOver:
+        case GBlendMode::kDstOver:  return dst || src;
+        case GBlendMode::kSrcIn:
+        case GBlendMode::kDstIn:    return dst && src;
+        default:                    return false;
+    }
+}
+
+class ComposeShader : public GShader {
+private:
+    GShader* fDst;
+    GShader* fSrc;
+    GBlendMode fMode;
+
+    // The src child is shaded a chunk at a time into a buffer on the stack, and blended straight
+    // into the dst child's pixels in row[], so both stay in L1 however wide the row is.
+    static constexpr int kChunk = 64;
+
+public:
+    ComposeShader(GShader* dst, GShader* src, GBlendMode mode)
+        : fDst(dst), fSrc(src), fMode(mode) {}
+
+    bool isOpaque() override {
+        return blend_is_opaque(fMode, fDst->isOpaque(), fSrc->isOpaque());
+    }
+
+    bool setContext(const GMatrix& ctm) override {
+        return fDst->setContext(ctm) && fSrc->setContext(ctm);
+    }
+
+    // rows repeat where both children's do; a constant child does not change the other's key
+    RowInvariance rowInvariance() override {
+        const RowInvariance d = fDst->rowInvariance(), s = fSrc->rowInvariance();
+        if (d == s && d != kKeyed_RowInvariance) return d;
+        if (d == kConstantY_RowInvariance && s == kKeyed_RowInvariance) return s;
+        if (s == kConstantY_RowInvariance && d == kKeyed_RowInvariance) return d;
+        return kNone_RowInvariance;
+    }
+
+    int64_t rowKey(int y) override {
+        return fDst->rowInvariance() == kKeyed_RowInvariance ? fDst->rowKey(y) : fSrc->rowKey(y);
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        GPixel src[kChunk];
+        while (count > 0) {
+            const int n = std::min(count, kChunk);
+            fDst->shadeRow(x, y, n, row);
+            fSrc->shadeRow(x, y, n, src);
+            for (int i = 0; i < n; ++i) {
+                row[i] = blend_func(fMode, src[i])(row[i], src[i]);
+            }
+            row += n;
+            x += n;
+            count -= n;
+        }
+    }
+};
+
+class ModulateShader : public GShader {
+private:
+    GShader* fShader;
+    uint8_t  fAlpha;
+
+public:
+    ModulateShader(GShader* shader, float alpha)
+        : fShader(shader), fAlpha((uint8_t)GRoundToInt(GPinToUnit(alpha) * 255)) {}
+
+    bool isOpaque() override {
+        return fAlpha == 255 && fShader->isOpaque();
+    }
+
+    bool setContext(const GMatrix& ctm) override {
+        return fShader->setContext(ctm);
+    }
+
+    RowInvariance rowInvariance() override {
+        return fShader->rowInvariance();
+    }
+
+    int64_t rowKey(int y) override {
+        return fShader->rowKey(y);
+    }
+
+    // premul, so scaling all four channels by the alpha is the whole job, done in place
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        fShader->shadeRow(x, y, count, row);
+        if (fAlpha == 255) return;
+        for (int i = 0; i < count; ++i) {
+            row[i] = fullPixelMulDivide255(row[i], fAlpha);
+        }
+    }
+};
+
+std::unique_ptr<GShader> GCreateComposeShader(GShader* dst, GShader* src, GBlendMode mode) {
+    if (!dst || !src) return nullptr;
+    return std::make_unique<ComposeShader>(dst, src, mode);
+}
+
+std::unique_ptr<GShader> GCreateModulateShader(GShader* shader, float alpha) {
+    if (!shader) return nullptr;
+    return std::make_unique<ModulateShader>(shader, alpha);
+}
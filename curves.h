@@ -0,0 +1,43 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef CURVES_H_
+#define CURVES_H_
+
+#include <cmath>
+
+#include "include/GPoint.h"
+
+/*
+ * Flattening of quadratic and cubic beziers into line segments for the scan converter. The
+ * segment counts keep every chord within kCurveTolerance pixels of the curve it replaces.
+ */
+constexpr float kCurveTolerance = 0.25f;
+
+static inline int segments_for(float deviation) {
+    return std::max(1, (int) std::ceil(std::sqrt(deviation / kCurveTolerance)));
+}
+
+static inline int quad_segments(const GPoint pts[3]) {
+    return segments_for((pts[0] - 2 * pts[1] + pts[2]).length() * 0.25f);
+}
+
+static inline int cubic_segments(const GPoint pts[4]) {
+    float d0 = (pts[0] - 2 * pts[1] + pts[2]).length();
+    float d1 = (pts[1] - 2 * pts[2] + pts[3]).length();
+    return segments_for(std::max(d0, d1) * 0.75f);
+}
+
+static inline GPoint eval_quad(const GPoint pts[3], float t) {
+    float mt = 1 - t;
+    return mt * mt * pts[0] + 2 * mt * t * pts[1] + t * t * pts[2];
+}
+
+static inline GPoint eval_cubic(const GPoint pts[4], float t) {
+    float mt = 1 - t;
+    return mt * mt * mt * pts[0] + 3 * mt * mt * t * pts[1] + 3 * mt * t * t * pts[2] +
+           t * t * t * pts[3];
+}
+
+#endif
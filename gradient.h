@@ -0,0 +1,250 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef GRADIENT_H_
+#define GRADIENT_H_
+
+#include "include/GColor.h"
+#include "include/GPixel.h"
+#include "include/GShader.h"
+#include "utils.h"
+
+#include <vector>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/*
+ * Map the gradient parameter t onto [0, 1] according to the tile mode.
+ */
+template <GShader::TileMode> float tile_unit(float t);
+
+template <> inline float tile_unit<GShader::kClamp>(float t) {
+    return GPinToUnit(t);
+}
+
+template <> inline float tile_unit<GShader::kRepeat>(float t) {
+    return t - floorf(t);
+}
+
+template <> inline float tile_unit<GShader::kMirror>(float t) {
+    t = t * 0.5f;
+    t = (t - floorf(t)) * 2.0f;     // [0, 2)
+    return t > 1.0f ? 2.0f - t : t;
+}
+
+/*
+ * A gradient's colors, interpolated (unpremul) between their stops into a table indexed by t in
+ * [0, 1], premultiplied both into pixels and into floats. Shading a pixel is then one lookup
+ * (or, with sample(), a blend of the two colors either side of t), no matter how many stops the
+ * gradient has or where they are.
+ *
+ * With pos == nullptr the stops are evenly spaced. Otherwise pos[i] is where colors[i] sits:
+ * the positions are pinned to [0, 1] and made non-decreasing, the first color fills everything
+ * before the first stop and the last color everything after the last one, and two stops at the
+ * same position make a hard edge.
+ */
+class GradientLUT {
+public:
+    static constexpr int kSize = 256;
+
+    GradientLUT(const GColor colors[], int count, const float pos[] = nullptr) {
+        fOpaque = true;
+        for (int i = 0; i < count; ++i) {
+            fOpaque &= GPinToUnit(colors[i].a) == 1.0f;
+            fColorStops.push_back(colors[i].pinToUnit());
+            if (pos) {
+                fPosStops.push_back(std::max(GPinToUnit(pos[i]), i ? fPosStops.back() : 0.0f));
+            }
+        }
+
+        for (int i = 0; i < kSize; ++i) {
+            const GColor c = this->at((float)i / (kSize - 1));
+            fTable[i] = color_to_pixel(c);
+            fPremul[i][GPIXEL_SHIFT_A / 8] = c.a * 255;
+            fPremul[i][GPIXEL_SHIFT_R / 8] = c.r * c.a * 255;
+            fPremul[i][GPIXEL_SHIFT_G / 8] = c.g * c.a * 255;
+            fPremul[i][GPIXEL_SHIFT_B / 8] = c.b * c.a * 255;
+        }
+        std::copy(fPremul[kSize - 1], fPremul[kSize - 1] + 4, fPremul[kSize]);
+
+        // each stop's reciprocal distance from the one before, and the first stop past it
+        for (int i = 0; i < (int)fPosStops.size(); ++i) {
+            const float span = i ? fPosStops[i] - fPosStops[i - 1] : 0.0f;
+            fInvSpan.push_back(span > 0 ? 1.0f / span : 0.0f);
+        }
+        fPastStop.resize(fPosStops.size());
+        for (int i = (int)fPosStops.size() - 1; i >= 0; --i) {
+            const bool tied = i + 1 < count && fPosStops[i + 1] == fPosStops[i];
+            fPastStop[i] = tied ? fPastStop[i + 1] : i + 1;
+        }
+
+        // the entries with a stop strictly between them and the next: the color bends there
+        for (int i = 0, stop = 0; i < kSize; ++i) {
+            fBent[i] = false;
+            // every t in entry i is past the stops before this one (see bentAt())
+            while (stop < (int)fPosStops.size() && fPosStops[stop] * (kSize - 1) < i) {
+                ++stop;
+            }
+            fBentStop[i] = stop;
+        }
+        for (int i = 0; i < count; ++i) {
+            const float x = (pos ? fPosStops[i] : (float)i / std::max(count - 1, 1)) * (kSize - 1);
+            const int entry = (int)x;
+            if (entry < kSize && x > entry) {
+                fBent[entry] = true;
+            }
+        }
+    }
+
+    bool isOpaque() const { return fOpaque; }
+    const GPixel* table() const { return fTable; }
+
+    // t must already be tiled onto [0, 1].
+    static int Index(float t) { return (int)(t * (kSize - 1) + 0.5f); }
+
+    GPixel lookup(float t) const { return fTable[Index(t)]; }
+
+    // t must already be tiled onto [0, 1]. Blends the entries either side of t instead of taking
+    // the nearest one, so a gradient spread over more than kSize pixels does not band; where a
+    // stop falls between the two, blending would cut its corner, so t is evaluated exactly.
+    GPixel sample(float t) const {
+#if defined(__SSE2__)
+        const float x = t * (kSize - 1);
+        const int i = (int)x;
+        if (fBent[i]) {
+            return color_to_pixel(this->bentAt(i, t));
+        }
+        // premul, so the blend stays premul. The lanes are the pixel's bytes in memory order, so
+        // packing them down is the pixel.
+        const float w = x - i, inv = 1.0f - w;
+        const __m128i c = Blend(fPremul[i], fPremul[i + 1], _mm_set1_ps(inv), _mm_set1_ps(w));
+        const __m128i v = _mm_packs_epi32(c, _mm_setzero_si128());
+        return (GPixel)_mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+#else
+        return this->sampleReference(t);
+#endif
+    }
+
+#if defined(__SSE2__)
+    // sample() for four t at once, into row[0..3]: the same float ops per lane, packed together.
+    void sample4(__m128 t, GPixel row[4]) const {
+        const __m128 x = _mm_mul_ps(t, _mm_set1_ps(kSize - 1));
+        const __m128i i4 = _mm_cvttps_epi32(x);
+        alignas(16) int32_t i[4];
+        _mm_store_si128((__m128i*)i, i4);
+        if (fBent[i[0]] | fBent[i[1]] | fBent[i[2]] | fBent[i[3]]) {
+            alignas(16) float ts[4];
+            _mm_store_ps(ts, t);
+            for (int k = 0; k < 4; ++k) {
+                row[k] = this->sample(ts[k]);
+            }
+            return;
+        }
+        const __m128 w = _mm_sub_ps(x, _mm_cvtepi32_ps(i4));
+        const __m128 inv = _mm_sub_ps(_mm_set1_ps(1.0f), w);
+        __m128i c[4];
+        c[0] = Blend(fPremul[i[0]], fPremul[i[0] + 1], _mm_shuffle_ps(inv, inv, 0x00),
+                     _mm_shuffle_ps(w, w, 0x00));
+        c[1] = Blend(fPremul[i[1]], fPremul[i[1] + 1], _mm_shuffle_ps(inv, inv, 0x55),
+                     _mm_shuffle_ps(w, w, 0x55));
+        c[2] = Blend(fPremul[i[2]], fPremul[i[2] + 1], _mm_shuffle_ps(inv, inv, 0xAA),
+                     _mm_shuffle_ps(w, w, 0xAA));
+        c[3] = Blend(fPremul[i[3]], fPremul[i[3] + 1], _mm_shuffle_ps(inv, inv, 0xFF),
+                     _mm_shuffle_ps(w, w, 0xFF));
+        const __m128i v = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]),
+                                           _mm_packs_epi32(c[2], c[3]));
+        _mm_storeu_si128((__m128i*)row, v);
+    }
+#endif
+
+    // sample(), one channel at a time: the reference backend's version (see reference.h).
+    GPixel sampleReference(float t) const {
+        const float x = t * (kSize - 1);
+        const int i = (int)x;
+        if (fBent[i]) {
+            return color_to_pixel(this->bentAt(i, t));
+        }
+        const float w = x - i, inv = 1.0f - w;
+        const float* c0 = fPremul[i];
+        const float* c1 = fPremul[i + 1];
+        GPixel pixel = 0;
+        for (int k = 0; k < 4; ++k) {
+            pixel |= (GPixel)(c0[k] * inv + c1[k] * w + 0.5f) << (8 * k);
+        }
+        return pixel;
+    }
+
+private:
+#if defined(__SSE2__)
+    // c0 * inv + c1 * w, rounded to ints (every value is >= 0, so + 0.5 and truncate rounds)
+    static __m128i Blend(const float* c0, const float* c1, __m128 inv, __m128 w) {
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(c0), inv),
+                                                      _mm_mul_ps(_mm_load_ps(c1), w)),
+                                           _mm_set1_ps(0.5f)));
+    }
+#endif
+
+    static GColor Mix(const GColor& c0, const GColor& c1, float w) {
+        const float inv = 1.0f - w;
+        return GColor::RGBA(c0.r * inv + c1.r * w,
+                            c0.g * inv + c1.g * w,
+                            c0.b * inv + c1.b * w,
+                            c0.a * inv + c1.a * w);
+    }
+
+    // The gradient's color at t, straight from the stops.
+    GColor at(float t) const {
+        const int count = (int)fColorStops.size();
+        if (fPosStops.empty()) {
+            t *= count - 1;
+            const int idx = std::min((int)t, std::max(count - 2, 0));
+            return Mix(fColorStops[idx], fColorStops[std::min(idx + 1, count - 1)], t - idx);
+        }
+
+        int stop = 0;           // how many stops lie at or before t
+        while (stop < count && fPosStops[stop] <= t) {
+            ++stop;
+        }
+        if (stop == 0) return fColorStops[0];
+        if (stop == count) return fColorStops[count - 1];
+        const float lo = fPosStops[stop - 1], hi = fPosStops[stop];
+        return Mix(fColorStops[stop - 1], fColorStops[stop], (t - lo) / (hi - lo));
+    }
+
+    /*
+     * at(t) for t in the bent entry i, without walking the stops from the first: it starts at
+     * fBentStop[i], and steps over a run of stops at one position at a time. So it only looks
+     * at the stops inside entry i, usually one, whatever the gradient's count.
+     */
+    GColor bentAt(int i, float t) const {
+        if (fPosStops.empty()) {
+            return this->at(t);
+        }
+        const int count = (int)fColorStops.size();
+        int stop = fBentStop[i];
+        while (stop < count && fPosStops[stop] <= t) {
+            stop = fPastStop[stop];
+        }
+        if (stop == 0) return fColorStops[0];
+        if (stop == count) return fColorStops[count - 1];
+        return Mix(fColorStops[stop - 1], fColorStops[stop],
+                   (t - fPosStops[stop - 1]) * fInvSpan[stop]);
+    }
+
+    std::vector<GColor> fColorStops;    // pinned
+    std::vector<float>  fPosStops;      // pinned and non-decreasing; empty when evenly spaced
+    std::vector<float>  fInvSpan;       // 1 / (fPosStops[i] - fPosStops[i - 1]), or 0 for none
+    std::vector<int>    fPastStop;      // the first stop positioned after stop i
+    // premul, scaled to [0, 255], in the order of the pixel's bytes in memory; the last entry is
+    // repeated, so sample() can read i + 1
+    alignas(16) float fPremul[kSize + 1][4];
+    GPixel fTable[kSize];
+    bool   fBent[kSize];
+    int    fBentStop[kSize];    // the first stop that entry i may not be past yet
+    bool   fOpaque;
+};
+
+#endif
@@ -62,6 +62,9 @@ public:
      *
      *  This automatically computes the opaqueness of the bitmap.
      *
+     *  QOI and raw bitmap files (see below) are recognized by their signature, and are read
+     *  the same way.
+     *
      *  On failure, return false and bitmap is reset to empty.
      */
     bool readFromFile(const char path[]);
@@ -72,11 +75,56 @@ public:
      */
     bool writeToFile(const char path[]) const;
 
+    /**
+     *  Attempt to read a QOI image stored in the named file. Same ownership rules as
+     *  readFromFile().
+     */
+    bool readFromQOIFile(const char path[]);
+
+    /*
+     *  Attempt to write the bitmap as a QOI image into a new file. Return true on success.
+     */
+    bool writeToQOIFile(const char path[]) const;
+
+    /**
+     *  Attempt to map a raw bitmap file (see writeToRawFile) without copying or decoding it.
+     *
+     *  On success the bitmap's pixels point directly into a read-only mapping of the file, so
+     *  it must not be used as a canvas device. The caller must call unmapRawFile() (not free())
+     *  when they are finished.
+     *
+     *  On failure, return false and bitmap is reset to empty.
+     */
+    bool mapRawFile(const char path[]);
+
+    /**
+     *  Release a mapping created by mapRawFile(), and reset the bitmap to empty.
+     */
+    void unmapRawFile();
+
+    /*
+     *  Attempt to write the bitmap in the raw format: a 64 byte header followed by premultiplied
+     *  GPixel rows, each padded to a multiple of 64 bytes. Return true on success.
+     */
+    bool writeToRawFile(const char path[]) const;
+
     /**
      *  Allocate the memory for the bitmap. If rowBytes is 0, it will be computed from w.
      */
     void alloc(int w, int h, size_t rowBytes = 0);
 
+    enum AllocMode {
+        kPacked_AllocMode,      // rowBytes == w * 4, same as alloc(w, h)
+        kAligned_AllocMode,     // 64 byte aligned pixels and rowBytes, never a multiple of 4K
+        kHugePage_AllocMode,    // kAligned, plus a transparent huge page hint for large bitmaps
+    };
+
+    /**
+     *  Allocate zeroed memory for the bitmap, laid out according to the mode. The pixels are
+     *  still released with free(), so callers must only ever address them through rowBytes().
+     */
+    void alloc(int w, int h, AllocMode);
+
 private:
     int     fWidth;
     int     fHeight;
@@ -97,6 +145,44 @@ private:
     static bool ComputeIsOpaque(const GBitmap&);
 };
 
+/**
+ *  Owns the pixels of a bitmap allocated with GBitmap::alloc() (or read with readFromFile()),
+ *  and frees them when it goes out of scope.
+ */
+class GPixelBuffer {
+public:
+    GPixelBuffer() {}
+    GPixelBuffer(int w, int h, GBitmap::AllocMode mode = GBitmap::kAligned_AllocMode) {
+        fBitmap.alloc(w, h, mode);
+    }
+    // Takes ownership of the bitmap's (malloc'd) pixels.
+    explicit GPixelBuffer(const GBitmap& bitmap) : fBitmap(bitmap) {}
+
+    GPixelBuffer(GPixelBuffer&& other) noexcept : fBitmap(other.fBitmap) { other.fBitmap.reset(); }
+    GPixelBuffer& operator=(GPixelBuffer&& other) noexcept {
+        if (this != &other) {
+            this->reset();
+            std::swap(fBitmap, other.fBitmap);
+        }
+        return *this;
+    }
+    GPixelBuffer(const GPixelBuffer&) = delete;
+    GPixelBuffer& operator=(const GPixelBuffer&) = delete;
+
+    ~GPixelBuffer() { this->reset(); }
+
+    const GBitmap& bitmap() const { return fBitmap; }
+    const GBitmap* operator->() const { return &fBitmap; }
+
+    void reset() {
+        free(fBitmap.pixels());
+        fBitmap.reset();
+    }
+
+private:
+    GBitmap fBitmap;
+};
+
 template <typename S> void visit_pixels(const GBitmap& bm, S&& visitor) {
     for (int y = 0; y < bm.height(); ++y) {
         for (int x = 0; x < bm.width(); ++x) {
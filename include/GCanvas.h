@@ -10,6 +10,7 @@
 #include <string>
 
 class GBitmap;
+struct GCanvasStats;
 class GPath;
 class GPoint;
 class GRect;
@@ -69,6 +70,13 @@ public:
      */
     virtual void drawPath(const GPath&, const GPaint&) = 0;
 
+    /**
+     *  Return the raster pipeline counters accumulated by this canvas's draws since it was
+     *  created (or since resetStats()), or null if the library was built without G_STATS.
+     */
+    virtual const GCanvasStats* getStats() const { return nullptr; }
+    virtual void resetStats() {}
+
     // Helpers
 
     void translate(float x, float y) {
@@ -99,6 +107,21 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Same as GCreateCanvas, but the canvas only ever writes the pixels inside area. Everything else
+ *  -- the transform, the clipping to the bitmap's bounds, the coordinates the shaders see -- is
+ *  that of a canvas over the whole bitmap, so the pixels in area come out exactly as that canvas
+ *  would draw them. For redrawing part of a bitmap. Returns NULL if area is not inside it.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, const GIRect& area);
+
+/**
+ *  Same as GCreateCanvas, but the canvas draws with the plain scalar reference implementation
+ *  of the raster pipeline. It must produce exactly the same pixels, only slower; it exists to
+ *  check the optimized one against.
+ */
+std::unique_ptr<GCanvas> GCreateReferenceCanvas(const GBitmap& bitmap);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
@@ -0,0 +1,63 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef GCanvasStats_DEFINED
+#define GCanvasStats_DEFINED
+
+#include "GBlendMode.h"
+
+/**
+ *  Counters from inside the raster pipeline, accumulated by a canvas's draws.
+ *
+ *  They are only collected when the library is built with G_STATS defined. Otherwise the
+ *  counting compiles away entirely and GCanvas::getStats() returns null.
+ */
+struct GCanvasStats {
+    enum AlphaClass {
+        kTransparent_AlphaClass,    // src alpha == 0
+        kOpaque_AlphaClass,         // src alpha == 0xFF
+        kPartial_AlphaClass,
+    };
+    static constexpr int kAlphaClassCount = 3;
+    static constexpr int kBlendModeCount = (int)GBlendMode::kXor + 1;
+
+    enum ShaderType {
+        kBitmap_ShaderType,
+        kLinearGradient_ShaderType,
+        kRadialGradient_ShaderType,
+        kSweepGradient_ShaderType,
+    };
+    static constexpr int kShaderTypeCount = 4;
+
+    uint64_t fEdgesBuilt;       // edges handed to the scan converter by the clipper
+    uint64_t fEdgesClipped;     // input segments that were culled, trimmed or pinned to a side
+    uint64_t fScanlines;        // rows visited by the scan converter
+    uint64_t fSpans;            // runs handed to the blitter
+    uint64_t fBlitPixels[kBlendModeCount][kAlphaClassCount];
+    uint64_t fShadedPixels[kShaderTypeCount];
+
+    GCanvasStats() { this->reset(); }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    static const char* BlendModeName(int mode) {
+        static const char* gNames[kBlendModeCount] = {
+            "clear", "src", "dst", "srcover", "dstover", "srcin", "dstin", "srcout", "dstout",
+            "srcatop", "dstatop", "xor",
+        };
+        return gNames[mode];
+    }
+    static const char* AlphaClassName(int ac) {
+        static const char* gNames[kAlphaClassCount] = { "transparent", "opaque", "partial" };
+        return gNames[ac];
+    }
+    static const char* ShaderTypeName(int type) {
+        static const char* gNames[kShaderTypeCount] = {
+            "bitmap", "linear_gradient", "radial_gradient", "sweep_gradient",
+        };
+        return gNames[type];
+    }
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef GColorFilter_DEFINED
+#define GColorFilter_DEFINED
+
+#include "GColor.h"
+
+/**
+ *  A 4x5 color matrix, applied to every color a paint draws (its color, or each pixel its
+ *  shader returns) before that color is blended. Tints, fades and desaturation, without an
+ *  offscreen pass.
+ *
+ *  The matrix is row-major, and works on unpremul colors in [0, 1]:
+ *
+ *      r' = m[ 0]*r + m[ 1]*g + m[ 2]*b + m[ 3]*a + m[ 4]
+ *      g' = m[ 5]*r + m[ 6]*g + m[ 7]*b + m[ 8]*a + m[ 9]
+ *      b' = m[10]*r + m[11]*g + m[12]*b + m[13]*a + m[14]
+ *      a' = m[15]*r + m[16]*g + m[17]*b + m[18]*a + m[19]
+ *
+ *  and the result is pinned back to [0, 1].
+ *
+ *  Like a shader, a paint does not own its color filter; it must outlive the draws.
+ */
+class GColorFilter {
+public:
+    explicit GColorFilter(const float matrix[20]);
+
+    /**
+     *  Scale each channel by a factor. With all four in [0, 1] this is the fast case: the
+     *  premul pixels are just scaled, with no unpremul, matrix or pin.
+     */
+    static GColorFilter Scale(float r, float g, float b, float a);
+
+    GColor filterColor(const GColor&) const;
+
+    const float* matrix() const { return fMatrix; }
+
+    // True if this is a Scale() with factors in [0, 1] (whichever way it was made).
+    bool isScale() const { return fIsScale; }
+
+private:
+    float fMatrix[20];
+    bool  fIsScale;
+};
+
+#endif
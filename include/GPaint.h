@@ -8,6 +8,7 @@
 #include "GColor.h"
 #include "GBlendMode.h"
 
+class GColorFilter;
 class GShader;
 
 class GPaint {
@@ -34,9 +35,13 @@ public:
     GShader* getShader() const { return fShader; }
     GPaint&  setShader(GShader* s) { fShader = s; return *this; }
 
+    const GColorFilter* getColorFilter() const { return fColorFilter; }
+    GPaint& setColorFilter(const GColorFilter* f) { fColorFilter = f; return *this; }
+
 private:
     GColor      fColor = {0, 0, 0, 1};
     GShader*    fShader = nullptr;
+    const GColorFilter* fColorFilter = nullptr;
     GBlendMode  fMode = GBlendMode::kSrcOver;
 };
 
@@ -6,6 +6,7 @@
 #define GShader_DEFINED
 
 #include <memory>
+#include "GBlendMode.h"
 #include "GColor.h"
 #include "GPixel.h"
 #include "GPoint.h"
@@ -24,6 +25,17 @@ public:
         kMirror,
     };
 
+    enum FilterMode {
+        kNearest_FilterMode,    // the texel containing the sample point
+        kLinear_FilterMode,     // bilinear blend of the 4 texels around the sample point
+    };
+
+    enum MipmapMode {
+        kNone_MipmapMode,       // always sample the bitmap itself
+        kNearest_MipmapMode,    // when minifying, sample the closest level of a box-filtered
+                                // pyramid (built lazily, on the first minified draw)
+    };
+
     virtual ~GShader() {}
 
     // Return true iff all of the GPixels that may be returned by this shader will be opaque.
@@ -38,6 +50,24 @@ public:
      *  can hold at least [count] entries.
      */
     virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+
+    enum RowInvariance {
+        kNone_RowInvariance,        // any row may differ from any other
+        kConstantY_RowInvariance,   // every row is the same: shadeRow ignores y
+        kConstantX_RowInvariance,   // each row is a single color: shadeRow ignores x
+        kKeyed_RowInvariance,       // rows whose rowKey() match are the same
+    };
+
+    /**
+     *  How the rows shaded under the current context (the last setContext) repeat. "The same"
+     *  means exactly the same pixels for the same x and count, so a caller may shade a row once
+     *  and reuse it (or, for kConstantX, shade one pixel and fill) instead of calling shadeRow
+     *  again.
+     */
+    virtual RowInvariance rowInvariance() { return kNone_RowInvariance; }
+
+    // For kKeyed_RowInvariance: rows y0 and y1 are the same if rowKey(y0) == rowKey(y1).
+    virtual int64_t rowKey(int y) { return y; }
 };
 
 /**
@@ -45,7 +75,9 @@ public:
  *  Returns null if the either parameter is invalid.
  */
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap&, const GMatrix& localInverse,
-                                             GShader::TileMode = GShader::kClamp);
+                                             GShader::TileMode = GShader::kClamp,
+                                             GShader::FilterMode = GShader::kNearest_FilterMode,
+                                             GShader::MipmapMode = GShader::kNone_MipmapMode);
 
 /**
  *  Return a subclass of GShader that draws the specified gradient of [count] colors between
@@ -61,6 +93,67 @@ std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap&, const GMatrix& loca
 std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor[], int count,
                                                GShader::TileMode = GShader::kClamp);
 
+/**
+ *  The gradient factories below that take pos[] place the colors at the given stops instead of
+ *  spacing them evenly: Color[i] sits at pos[i] along the gradient, from 0 (p0, the center, or
+ *  the start angle) to 1. The positions are pinned to [0, 1] and should not decrease; two
+ *  equal positions make a hard edge. The first color fills everything before the first stop,
+ *  and the last color everything after the last one. A null pos[] means evenly spaced.
+ *
+ *  However many stops there are, the colors are baked into one table up front, so they cost
+ *  nothing per pixel.
+ */
+std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor[],
+                                               const float pos[], int count,
+                                               GShader::TileMode = GShader::kClamp);
+
+/**
+ *  Return a subclass of GShader that draws a radial gradient of [count] colors, centered on
+ *  center. Color[0] corresponds to the center, Color[count-1] to the circle of the given
+ *  radius, and all intermediate colors are evenly spaced between. The tile mode decides what
+ *  lies beyond the radius.
+ *
+ *  If count < 1 or radius <= 0, this returns nullptr.
+ */
+std::unique_ptr<GShader> GCreateRadialGradient(GPoint center, float radius,
+                                               const GColor[], int count,
+                                               GShader::TileMode = GShader::kClamp);
+std::unique_ptr<GShader> GCreateRadialGradient(GPoint center, float radius,
+                                               const GColor[], const float pos[], int count,
+                                               GShader::TileMode = GShader::kClamp);
+
+/**
+ *  Return a subclass of GShader that draws a sweep (angular) gradient of [count] colors around
+ *  center. Color[0] starts at the angle startRadians (0 points along +x), and the colors are
+ *  evenly spaced around one clockwise turn, with Color[count-1] just before the start again.
+ *
+ *  If count < 1, this returns nullptr.
+ */
+std::unique_ptr<GShader> GCreateSweepGradient(GPoint center, float startRadians,
+                                              const GColor[], int count);
+std::unique_ptr<GShader> GCreateSweepGradient(GPoint center, float startRadians,
+                                              const GColor[], const float pos[], int count);
+
+/**
+ *  Return a subclass of GShader that blends the colors of two shaders, as if src were drawn
+ *  over dst with the given blend mode. Both are shaded and blended a small chunk of the row at
+ *  a time, so no full row of either is ever buffered.
+ *
+ *  The children are not owned (just like GPaint's shader), and must outlive the returned one.
+ *  If either is null, this returns nullptr.
+ */
+std::unique_ptr<GShader> GCreateComposeShader(GShader* dst, GShader* src, GBlendMode);
+
+/**
+ *  Return a subclass of GShader that scales the colors of shader by alpha (pinned to [0, 1]).
+ *  GCanvas ignores the paint's color when the paint has a shader, so wrapping the shader with
+ *  the paint's alpha is how to fade it.
+ *
+ *  The shader is not owned, and must outlive the returned one. If it is null, this returns
+ *  nullptr.
+ */
+std::unique_ptr<GShader> GCreateModulateShader(GShader*, float alpha);
+
 static inline std::unique_ptr<GShader>
 GCreateLinearGradient(GPoint p0, GPoint p1,
                       const GColor& c0, const GColor& c1,
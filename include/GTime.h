@@ -8,10 +8,17 @@
 #include "GTypes.h"
 
 using GMSec = unsigned long;
+using GNSec = uint64_t;
 
 class GTime {
 public:
     static GMSec GetMSec();
+
+    /**
+     *  Nanoseconds from a monotonic clock (unaffected by wall clock changes). Only differences
+     *  between two readings are meaningful.
+     */
+    static GNSec GetNSec();
 };
 
 #endif
@@ -0,0 +1,30 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef GTrace_DEFINED
+#define GTrace_DEFINED
+
+/**
+ *  Draw call tracing, in the Chrome trace_event format (load the file in chrome://tracing or
+ *  ui.perfetto.dev).
+ *
+ *  While tracing, every draw on any canvas records one event: the op, its vertex and edge
+ *  counts, the device bounds and number of pixels it touched, and the time spent in each phase
+ *  (transform, clip, sort, scan, blit). Events go into a fixed size ring buffer owned by the
+ *  drawing thread, so threads never contend; when a buffer fills, its oldest events are
+ *  dropped.
+ */
+
+/**
+ *  Start a new trace, discarding any events from a previous one.
+ */
+void GTraceBegin(int eventsPerThread = 1 << 16);
+
+/**
+ *  Stop tracing and write the buffered events of every thread to path. Draws should have
+ *  finished on all threads before calling this. Return true on success.
+ */
+bool GTraceEnd(const char path[]);
+
+#endif
@@ -6,109 +6,102 @@
 #include "include/GShader.h"
 #include "include/GPixel.h"
 #include "include/GPoint.h"
+#include "gradient.h"
+#include "reference.h"
+#include "stats.h"
 #include "utils.h"
 
 class LinearGradient : public GShader {
 private:
-    GColor* fColors;
+    GradientLUT fLUT;
     GMatrix fInverse;
     GMatrix fUnit;
-    int fColorsCount;
-    bool fOpaque = true;
-public:
-    LinearGradient(GPoint p0, GPoint p1, const GColor colors[], int count) {
-        this->fColorsCount = count;
-        this->fColors = (GColor*) malloc(count * sizeof(GColor));
-        memcpy(fColors, colors, count * sizeof (GColor));
+    TileMode fTileMode;
 
-        float dx = std::abs(p1.x - p0.x);
-        float dy = std::abs(p1.y - p0.y);
-        this->fUnit = {dx, -dy, p0.x,
-                       dy, dx, p0.y};
+    template <TileMode TM> void shade(int x, int y, int count, GPixel row[]) {
+        GPoint local = fInverse * GPoint{x + .5f, y + .5f};
+        float dx = fInverse[0];
 
-        for (int i = 0; i < count; ++i) {
-            fColors[i].pinToUnit();
-            if (this->fOpaque && fColors[i].a < 1.0f) {
-                this->fOpaque = false;
-            }
+        int i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= count; i += 4) {
+            const float t0 = tile_unit<TM>(local.x);
+            const float t1 = tile_unit<TM>(local.x += dx);
+            const float t2 = tile_unit<TM>(local.x += dx);
+            const float t3 = tile_unit<TM>(local.x += dx);
+            local.x += dx;
+            fLUT.sample4(_mm_setr_ps(t0, t1, t2, t3), row + i);
         }
+#endif
+        for (; i < count; ++i) {
+            row[i] = fLUT.sample(tile_unit<TM>(local.x));
+            local.x += dx;
+        }
+    }
 
+    // The loop above as the reference backend runs it: scalar, channel by channel.
+    template <TileMode TM> void shade_reference(int x, int y, int count, GPixel row[]) {
+        GPoint local = fInverse * GPoint{x + .5f, y + .5f};
+        float dx = fInverse[0];
+
+        for (int i = 0; i < count; ++i) {
+            row[i] = fLUT.sampleReference(tile_unit<TM>(local.x));
+            local.x += dx;
+        }
     }
 
-    ~LinearGradient() {
-        free(this->fColors);
+public:
+    LinearGradient(GPoint p0, GPoint p1, const GColor colors[], const float pos[], int count,
+                   TileMode tileMode)
+        : fLUT(colors, count, pos)
+        , fTileMode(tileMode) {
+        float dx = p1.x - p0.x;
+        float dy = p1.y - p0.y;
+        this->fUnit = {dx, -dy, p0.x,
+                       dy, dx, p0.y};
     }
 
     bool isOpaque() override {
-        return this->fOpaque;
+        return fLUT.isOpaque();
     }
 
     bool setContext(const GMatrix &ctm) override {
         return (ctm * this->fUnit).invert(&this->fInverse);
     }
 
-    void shadeRow(int x, int y, int count, GPixel row[]) override {
-        GPoint local = fInverse * GPoint{x + .5f, y + .5f};
-        float dx = fInverse[0];
-
-        /* Early stopping cases */
-        if (fColorsCount == 1) {
-            GPixel pixel = color_to_pixel(fColors[0]);
-            std::fill(row, row + count, pixel);
-        } else if (fColorsCount == 2) {
-            GColor c1 = fColors[0];
-            GColor c2 = fColors[1];
-            for (int i = 0; i < count; ++i) {
-                float t = GPinToUnit(local.x);
-                float inverse = 1.0f - t;
-
-                row[i] = color_to_pixel(
-                        GColor::RGBA(
-                                c1.r * inverse + c2.r * t,
-                                c1.g * inverse + c2.g * t,
-                                c1.b * inverse + c2.b * t,
-                                c1.a * inverse + c2.a * t)
-                );
-
-                local.x += dx;
-            }
-        } else {
-            /* Generic case */
-            float stride = 1.0f / (fColorsCount - 1);
-
-            for (int i = 0; i < count; ++i) {
-                float t = GPinToUnit(local.x);
-
-                if (t == 0)
-                    row[i] = color_to_pixel(fColors[0]);
-                else if (t == 1.0f)
-                    row[i] = color_to_pixel(fColors[fColorsCount - 1]);
-                else {
-                    int idx = static_cast<int>(std::floor(t * (fColorsCount - 1)));
-                    float start = idx * stride;
-
-                    GColor c1 = fColors[idx];
-                    GColor c2 = fColors[idx + 1];
-
-                    t = GPinToUnit((t - start) / stride);
-                    float inverse = 1.0f - t;
-
-                    row[i] = color_to_pixel(
-                            GColor::RGBA(
-                                    c1.r * inverse + c2.r * t,
-                                    c1.g * inverse + c2.g * t,
-                                    c1.b * inverse + c2.b * t,
-                                    c1.a * inverse + c2.a * t)
-                    );
-                }
+    // t is inv[0] * x + inv[1] * y + inv[2], so an exactly zero term drops x or y out of it
+    RowInvariance rowInvariance() override {
+        if (fInverse[1] == 0) return kConstantY_RowInvariance;
+        if (fInverse[0] == 0) return kConstantX_RowInvariance;
+        return kNone_RowInvariance;
+    }
 
-                local.x += dx;
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        G_STAT_ADD(fShadedPixels[GCanvasStats::kLinearGradient_ShaderType], count);
+        if (gReferenceBackend) {
+            switch (fTileMode) {
+                case kClamp:  this->shade_reference<kClamp>(x, y, count, row);  break;
+                case kRepeat: this->shade_reference<kRepeat>(x, y, count, row); break;
+                case kMirror: this->shade_reference<kMirror>(x, y, count, row); break;
             }
+            return;
+        }
+        switch (fTileMode) {
+            case kClamp:  this->shade<kClamp>(x, y, count, row);  break;
+            case kRepeat: this->shade<kRepeat>(x, y, count, row); break;
+            case kMirror: this->shade<kMirror>(x, y, count, row); break;
         }
     }
 };
 
-std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor colors[], int count) {
+std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor colors[],
+                                               const float pos[], int count,
+                                               GShader::TileMode tileMode) {
     if (count < 1) return nullptr;
-    return std::make_unique<LinearGradient>(p0, p1, colors, count);
-}
\ No newline at end of file
+    return std::make_unique<LinearGradient>(p0, p1, colors, pos, count, tileMode);
+}
+
+std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColor colors[], int count,
+                                               GShader::TileMode tileMode) {
+    return GCreateLinearGradient(p0, p1, colors, nullptr, count, tileMode);
+}
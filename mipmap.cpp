@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "mipmap.h"
+#include "reference.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+Mipmap::Mipmap(const GBitmap &base) : fBase(base) {}
+
+int Mipmap::count_levels() const {
+    int levels = 1;
+    for (int size = std::max(fBase.width(), fBase.height()); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+const GBitmap &Mipmap::level(int index) {
+    assert(index >= 0 && index < this->count_levels());
+
+    while ((int) fLevels.size() < index) {
+        const GBitmap &src = fLevels.empty() ? fBase : fLevels.back().bitmap();
+        GBitmap dst;
+        dst.alloc(std::max(src.width() >> 1, 1), std::max(src.height() >> 1, 1),
+                  GBitmap::kAligned_AllocMode);
+        downsample_2x2(src, dst);
+        dst.setIsOpaque(src.isOpaque() ? GBitmap::kYes_IsOpaque : GBitmap::kNo_IsOpaque);
+        fLevels.emplace_back(dst);
+    }
+    return index == 0 ? fBase : fLevels[index - 1].bitmap();
+}
+
+int Mipmap::choose_level(const GMatrix &inverse) const {
+    // texels stepped per device pixel, along x and along y
+    float sx = GPoint{inverse[0], inverse[3]}.length();
+    float sy = GPoint{inverse[1], inverse[4]}.length();
+    float scale = std::max(sx, sy);
+    if (!(scale >= 2.0f)) {
+        return 0;
+    }
+    return std::min(GFloorToInt(log2f(scale)), this->count_levels() - 1);
+}
+
+/*
+ * Each dst pixel is the rounded average of a 2x2 block of src. An odd last row or column is
+ * dropped, except that a 1 pixel dimension is averaged with itself.
+ */
+static inline GPixel average_4(GPixel a, GPixel b, GPixel c, GPixel d) {
+    // spread the channels out so they can be summed without carrying into each other
+    auto lo = [](GPixel p) { return (uint64_t) (p & 0x00FF00FF); };
+    auto hi = [](GPixel p) { return (uint64_t) ((p >> 8) & 0x00FF00FF); };
+    const uint64_t two = 0x00020002;
+    uint64_t sum_lo = (lo(a) + lo(b) + lo(c) + lo(d) + two) >> 2;
+    uint64_t sum_hi = (hi(a) + hi(b) + hi(c) + hi(d) + two) >> 2;
+    return (GPixel) ((sum_lo & 0x00FF00FF) | ((sum_hi & 0x00FF00FF) << 8));
+}
+
+static void downsample_row(GPixel dst[], int count, const GPixel *r0, const GPixel *r1,
+                           int src_width) {
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+
+    // 4 dst pixels from 8 src pixels on each of the two rows
+    auto sum_pairs = [&](__m128i a, __m128i b) {
+        // a, b hold 4 src pixels each; returns 2 column pairs summed over both rows, 16 bit
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    };
+    for (; !gReferenceBackend && x + 4 <= count && 2 * x + 8 <= src_width; x += 4) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *) (r0 + 2 * x));
+        __m128i a1 = _mm_loadu_si128((const __m128i *) (r0 + 2 * x + 4));
+        __m128i b0 = _mm_loadu_si128((const __m128i *) (r1 + 2 * x));
+        __m128i b1 = _mm_loadu_si128((const __m128i *) (r1 + 2 * x + 4));
+
+        __m128i s0 = _mm_srli_epi16(_mm_add_epi16(sum_pairs(a0, b0), two), 2);
+        __m128i s1 = _mm_srli_epi16(_mm_add_epi16(sum_pairs(a1, b1), two), 2);
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(s0, s1));
+    }
+#endif
+    for (; x < count; ++x) {
+        int x0 = std::min(2 * x, src_width - 1);
+        int x1 = std::min(2 * x + 1, src_width - 1);
+        dst[x] = average_4(r0[x0], r0[x1], r1[x0], r1[x1]);
+    }
+}
+
+void downsample_2x2(const GBitmap &src, const GBitmap &dst) {
+    for (int y = 0; y < dst.height(); ++y) {
+        int y0 = std::min(2 * y, src.height() - 1);
+        int y1 = std::min(2 * y + 1, src.height() - 1);
+        downsample_row(dst.getAddr(0, y), dst.width(),
+                       src.getAddr(0, y0), src.getAddr(0, y1), src.width());
+    }
+}
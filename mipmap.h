@@ -0,0 +1,37 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef MIPMAP_H_
+#define MIPMAP_H_
+
+#include <vector>
+
+#include "include/GBitmap.h"
+#include "include/GMatrix.h"
+
+/*
+ * A pyramid of successively 2x2 box-filtered copies of a bitmap. Level 0 is the bitmap itself
+ * (not copied); deeper levels are built on first use and kept for the life of the Mipmap.
+ */
+class Mipmap {
+private:
+    GBitmap fBase;
+    std::vector<GPixelBuffer> fLevels;  // fLevels[i] is level i + 1
+public:
+    explicit Mipmap(const GBitmap &);
+
+    int count_levels() const;
+
+    const GBitmap &level(int);
+
+    /*
+     * The level whose texels are closest to one per device pixel, for a device -> level 0
+     * inverse matrix. 0 when the bitmap is not being minified.
+     */
+    int choose_level(const GMatrix &inverse) const;
+};
+
+void downsample_2x2(const GBitmap &src, const GBitmap &dst);
+
+#endif
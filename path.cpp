@@ -3,6 +3,7 @@
  */
 
 #include "include/GPath.h"
+#include "include/GMath.h"
 #include "include/GMatrix.h"
 
 template <unsigned N> class PointsIterator {
@@ -53,29 +54,129 @@ void GPath::addRect(const GRect& rect, GPath::Direction direction) {
     this->lineTo(it.next());
 }
 
-GRect GPath::bounds() const {
-    int count = this->fPts.size();
+/*
+ * Grow [lo, hi] to hold the quad's extremum along one axis, if it has one inside (0, 1).
+ */
+static void quad_extrema(float a, float b, float c, float& lo, float& hi) {
+    float denom = a - 2 * b + c;
+    if (denom == 0) return;
+    float t = (a - b) / denom;
+    if (t > 0 && t < 1) {
+        float mt = 1 - t;
+        float v = mt * mt * a + 2 * mt * t * b + t * t * c;
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+}
+
+/*
+ * Same for the (up to two) extrema of a cubic: the roots of its derivative.
+ */
+static void cubic_extrema(float a, float b, float c, float d, float& lo, float& hi) {
+    // derivative / 3 = A t^2 + B t + C
+    float A = -a + 3 * b - 3 * c + d;
+    float B = 2 * (a - 2 * b + c);
+    float C = b - a;
+
+    float roots[2];
+    int count = 0;
+    if (std::abs(A) < 1e-9f) {
+        if (B != 0) roots[count++] = -C / B;
+    } else {
+        float disc = B * B - 4 * A * C;
+        if (disc >= 0) {
+            float sq = sqrtf(disc);
+            roots[count++] = (-B + sq) / (2 * A);
+            roots[count++] = (-B - sq) / (2 * A);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        float t = roots[i];
+        if (t > 0 && t < 1) {
+            float mt = 1 - t;
+            float v = mt * mt * mt * a + 3 * mt * mt * t * b + 3 * mt * t * t * c + t * t * t * d;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+    }
+}
 
-    if (count < 1) return GRect::WH(0, 0);
+GRect GPath::bounds() const {
+    if (this->fPts.empty()) return GRect::WH(0, 0);
 
+    // every on-curve point, plus the extrema of the curves between them
     float x_min = this->fPts[0].x;
     float y_min = this->fPts[0].y;
     float x_max = x_min;
     float y_max = y_min;
 
-    for (int i = 1; i < count; i++) {
-        const GPoint& p = this->fPts[i];
-
-        x_min = std::min(x_min, p.x);
-        x_max = std::max(x_max, p.x);
-        y_min = std::min(y_min, p.y);
-        y_max = std::max(y_max, p.y);
+    GPoint pts[kMaxNextPoints];
+    Iter iter(*this);
+    for (Verb verb; (verb = iter.next(pts)) != kDone; ) {
+        const GPoint& end = pts[verb == kMove ? 0 : verb];     // the last point of the verb
+        x_min = std::min(x_min, end.x);
+        x_max = std::max(x_max, end.x);
+        y_min = std::min(y_min, end.y);
+        y_max = std::max(y_max, end.y);
+
+        if (verb == kQuad) {
+            quad_extrema(pts[0].x, pts[1].x, pts[2].x, x_min, x_max);
+            quad_extrema(pts[0].y, pts[1].y, pts[2].y, y_min, y_max);
+        } else if (verb == kCubic) {
+            cubic_extrema(pts[0].x, pts[1].x, pts[2].x, pts[3].x, x_min, x_max);
+            cubic_extrema(pts[0].y, pts[1].y, pts[2].y, pts[3].y, y_min, y_max);
+        }
     }
 
     return GRect::LTRB(x_min, y_min, x_max, y_max);
 }
 
-
 void GPath::transform(const GMatrix& matrix) {
     matrix.mapPoints(this->fPts.data(), this->fPts.data(), this->fPts.size());
-}
\ No newline at end of file
+}
+void GPath::addCircle(GPoint center, float radius, GPath::Direction direction) {
+    // 8 quads, each spanning 45 degrees: the control point sits on the bisecting ray, where the
+    // tangents at the two ends meet
+    const float step = gFloatPI / 4;
+    const float ctrl_radius = radius / cosf(step / 2);
+    const float sign = direction == kCW_Direction ? 1 : -1;
+
+    this->moveTo({center.x + radius, center.y});
+    for (int i = 0; i < 8; ++i) {
+        float mid = sign * (i + 0.5f) * step;
+        float end = sign * (i + 1) * step;
+        this->quadTo({center.x + ctrl_radius * cosf(mid), center.y + ctrl_radius * sinf(mid)},
+                     {center.x + radius * cosf(end), center.y + radius * sinf(end)});
+    }
+}
+
+static inline GPoint lerp(GPoint a, GPoint b, float t) {
+    return a + (b - a) * t;
+}
+
+void GPath::ChopQuadAt(const GPoint src[3], GPoint dst[5], float t) {
+    GPoint ab = lerp(src[0], src[1], t);
+    GPoint bc = lerp(src[1], src[2], t);
+
+    dst[0] = src[0];
+    dst[1] = ab;
+    dst[2] = lerp(ab, bc, t);
+    dst[3] = bc;
+    dst[4] = src[2];
+}
+
+void GPath::ChopCubicAt(const GPoint src[4], GPoint dst[7], float t) {
+    GPoint ab = lerp(src[0], src[1], t);
+    GPoint bc = lerp(src[1], src[2], t);
+    GPoint cd = lerp(src[2], src[3], t);
+    GPoint abc = lerp(ab, bc, t);
+    GPoint bcd = lerp(bc, cd, t);
+
+    dst[0] = src[0];
+    dst[1] = ab;
+    dst[2] = abc;
+    dst[3] = lerp(abc, bcd, t);
+    dst[4] = bcd;
+    dst[5] = cd;
+    dst[6] = src[3];
+}
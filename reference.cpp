@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "include/GMath.h"
+#include "include/GShader.h"
+#include "blends.h"
+#include "blitter.h"
+#include "color_filter.h"
+#include "reference.h"
+#include "utils.h"
+
+thread_local bool gReferenceBackend = false;
+
+void Blit::blit_reference(float x_left, float x_right, int y) {
+    if (y < this->fArea.top || y >= this->fArea.bottom) return;
+
+    // shade the span of the whole device, as blit_horizontal does, and write the area's part
+    int x_l_int = std::max(GRoundToInt(x_left), 0);
+    int x_r_int = std::min(GRoundToInt(x_right), this->fDevice.width());
+    int w_left = std::max(x_l_int, this->fArea.left);
+    int w_right = std::min(x_r_int, this->fArea.right);
+
+    if (w_left >= w_right) return;
+
+    GShader *shader = this->fPaint.getShader();
+    GPixel *row = shader ? this->buffer() : nullptr;
+    if (shader) {
+        shader->shadeRow(x_l_int, y, x_r_int - x_l_int, row);
+        if (this->fPaint.getColorFilter()) {
+            filter_row(*this->fPaint.getColorFilter(), row, x_r_int - x_l_int);
+        }
+    }
+
+    // one pixel at a time, choosing the blend for each
+    GPixel solid = color_to_pixel(paint_color(this->fPaint));
+    for (int i = w_left; i < w_right; ++i) {
+        GPixel src = shader ? row[i - x_l_int] : solid;
+        GPixel *dst = this->fDevice.getAddr(i, y);
+        *dst = blend_func(this->fPaint.getBlendMode(), src)(*dst, src);
+    }
+}
+
+void ReferenceScanConverter::scan_rect(GIRect& rect, Blit& blit) {
+    for (int y = std::max(0, rect.top); y < rect.bottom; ++y) {
+        blit.blit_reference(rect.left, rect.right, y);
+    }
+}
+
+void ReferenceScanConverter::scan_convex(Edge *edges, int count, Blit& blit) {
+    if (count < 2) return;
+
+    std::sort(edges, edges + count, compare_edge);
+
+    int y_last = edges[count - 1].y_min;
+
+    Edge *left = &edges[0];
+    Edge *right = &edges[1];
+    int edge_idx = 2;
+
+    int y_cur = left->y_max;
+    float x_left = left->cur_x;
+    float x_right = right->cur_x;
+
+    while (y_cur < y_last) {
+        blit.blit_reference(x_left, x_right, y_cur++);
+
+        if (left->y_min <= y_cur) {
+            left = &edges[edge_idx++];
+            x_left = left->cur_x;
+        } else {
+            x_left += left->m;
+        }
+
+        if (right->y_min <= y_cur) {
+            right = &edges[edge_idx++];
+            x_right = right->cur_x;
+        } else {
+            x_right += right->m;
+        }
+    }
+}
+
+void ReferenceScanConverter::scan_complex(Edge *edges, int count, Blit &blit) {
+    if (count < 2) return;
+
+    std::sort(edges, edges + count, compare_edge);
+
+    int y = edges->y_max;
+
+    while (count > 0) {
+        int curr = 0, x0 = 0, x1, winding = 0;
+
+        while (curr < count && edges[curr].y_max <= y) {
+            if (winding == 0)
+                x0 = GRoundToInt(edges[curr].cur_x);
+
+            winding += edges[curr].wind;
+
+            if (winding == 0) {
+                x1 = GRoundToInt(edges[curr].cur_x);
+                blit.blit_reference(x0, x1, y);
+            }
+
+            if (y + 1 >= edges[curr].y_min) {
+                memmove(&edges[curr], &edges[curr + 1], sizeof(Edge) * (count - curr - 1));
+                count--;
+            } else {
+                edges[curr].cur_x += edges[curr].m;
+                curr++;
+            }
+        }
+
+        y++;
+
+        while (curr < count && y == edges[curr].y_max) curr++;
+
+        std::sort(edges, edges + curr, [](const Edge& a, const Edge& b) -> bool {
+            return a.cur_x < b.cur_x;
+        });
+    }
+}
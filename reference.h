@@ -0,0 +1,40 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef REFERENCE_H_
+#define REFERENCE_H_
+
+#include "include/GRect.h"
+#include "blitter.h"
+#include "edge.h"
+
+/*
+ * The reference backend: the scan converters, blitter and shader loops as they were before any
+ * of them were vectorized or moved to fixed point, kept plain and scalar on purpose. The fast
+ * backend must draw exactly the same pixels; apps/fuzz.cpp checks that it does. Change these
+ * only to fix a bug, and then in both backends.
+ *
+ * A reference canvas (GCreateReferenceCanvas) sets gReferenceBackend for the duration of each
+ * draw (see ReferenceScope), which is how the shaders pick their scalar loops.
+ */
+extern thread_local bool gReferenceBackend;
+
+class ReferenceScope {
+private:
+    bool fPrev;
+public:
+    explicit ReferenceScope(bool reference) : fPrev(gReferenceBackend) {
+        gReferenceBackend = reference;
+    }
+    ~ReferenceScope() { gReferenceBackend = fPrev; }
+};
+
+class ReferenceScanConverter {
+public:
+    static void scan_rect(GIRect&, Blit&);
+    static void scan_convex(Edge*, int, Blit&);
+    static void scan_complex(Edge*, int, Blit&);
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "include/GMatrix.h"
+#include "include/GShader.h"
+#include "include/GPixel.h"
+#include "include/GPoint.h"
+#include "gradient.h"
+#include "reference.h"
+#include "stats.h"
+#include "utils.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/*
+ * sqrt(x) for x >= 0, through the classic bit trick estimate of 1/sqrt(x) and two Newton steps
+ * (relative error under 5e-6). The vector version below does exactly the same float ops.
+ */
+static inline float approx_sqrt(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, 4);
+    bits = 0x5f3759df - (bits >> 1);
+    float y;
+    memcpy(&y, &bits, 4);
+
+    const float half = 0.5f * x;
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    return x * y;
+}
+
+#if defined(__SSE2__)
+static inline __m128 approx_sqrt(__m128 x) {
+    const __m128i bits = _mm_sub_epi32(_mm_set1_epi32(0x5f3759df),
+                                       _mm_srli_epi32(_mm_castps_si128(x), 1));
+    __m128 y = _mm_castsi128_ps(bits);
+
+    const __m128 half = _mm_mul_ps(_mm_set1_ps(0.5f), x);
+    const __m128 three_halves = _mm_set1_ps(1.5f);
+    y = _mm_mul_ps(y, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, y), y)));
+    y = _mm_mul_ps(y, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, y), y)));
+    return _mm_mul_ps(x, y);
+}
+
+/*
+ * tile_unit() for t >= 0 (a distance), four at a time. Past 2^23 floats have no fraction left,
+ * so pinning there keeps the int conversion in range without changing the result.
+ */
+template <GShader::TileMode> __m128 tile_unit_4(__m128 t);
+
+template <> inline __m128 tile_unit_4<GShader::kClamp>(__m128 t) {
+    return _mm_min_ps(t, _mm_set1_ps(1.0f));
+}
+
+template <> inline __m128 tile_unit_4<GShader::kRepeat>(__m128 t) {
+    t = _mm_min_ps(t, _mm_set1_ps(8388608.0f));
+    return _mm_sub_ps(t, _mm_cvtepi32_ps(_mm_cvttps_epi32(t)));
+}
+
+template <> inline __m128 tile_unit_4<GShader::kMirror>(__m128 t) {
+    t = _mm_min_ps(_mm_mul_ps(t, _mm_set1_ps(0.5f)), _mm_set1_ps(8388608.0f));
+    t = _mm_mul_ps(_mm_sub_ps(t, _mm_cvtepi32_ps(_mm_cvttps_epi32(t))), _mm_set1_ps(2.0f));
+    return _mm_min_ps(t, _mm_sub_ps(_mm_set1_ps(2.0f), t));
+}
+#endif
+
+class RadialGradient : public GShader {
+private:
+    GradientLUT fLUT;
+    GMatrix fInverse;
+    GMatrix fUnit;
+    TileMode fTileMode;
+    bool fSample = false;   // blend the table's entries, instead of taking the nearest
+
+    // Rows are shaded in chunks, each starting from an exactly computed distance, so the
+    // rounding error of the incremental steps cannot build up along a wide row.
+    static constexpr int kChunk = 64;
+
+    /*
+     * The distance is measured in the unit circle's space, where p steps by d per pixel. The
+     * squared distance |p + i*d|^2 is quadratic in i, so it is forward differenced: two adds per
+     * pixel instead of two multiplies and an add. Pixel i + j of each group of four is lane j,
+     * stepping by d2(i + j + 4) - d2(i + j) = 8 p.d + (8(i + j) + 16) dd. The scalar loop runs
+     * the same four lanes, so the two round alike and shade the same pixels.
+     */
+    template <TileMode TM> void shade(int x, int y, int count, GPixel row[]) {
+        GPoint p = fInverse * GPoint{x + .5f, y + .5f};
+        const float dx = fInverse[0];
+        const float dy = fInverse[3];
+        const float dd = dx * dx + dy * dy;
+        const GPixel* table = fLUT.table();
+
+        while (count > 0) {
+            const int n = std::min(count, kChunk);
+            const float pd = p.x * dx + p.y * dy;
+            const float d2_0 = p.x * p.x + p.y * p.y;
+            const float delta2 = 32 * dd;
+            // the steps' rounding can take d2 a hair below 0 at the center, and a negative
+            // distance would tile differently in the two loops, so both pin it at 0
+            float d2[4], delta[4];
+            for (int j = 0; j < 4; ++j) {
+                d2[j] = d2_0 + (float)j * (2 * pd + (float)j * dd);
+                delta[j] = 8 * pd + ((float)j * 8 + 16) * dd;
+            }
+            int i = 0;
+
+#if defined(__SSE2__)
+            __m128 d2_4 = _mm_loadu_ps(d2);
+            __m128 delta_4 = _mm_loadu_ps(delta);
+            for (; !gReferenceBackend && i + 4 <= n; i += 4) {
+                const __m128 t = tile_unit_4<TM>(approx_sqrt(_mm_max_ps(d2_4, _mm_setzero_ps())));
+                if (fSample) {
+                    fLUT.sample4(t, row + i);
+                } else {
+                    const __m128i idx = _mm_cvttps_epi32(
+                            _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(GradientLUT::kSize - 1)),
+                                       _mm_set1_ps(0.5f)));
+                    alignas(16) int32_t index[4];
+                    _mm_store_si128((__m128i*)index, idx);
+                    row[i + 0] = table[index[0]];
+                    row[i + 1] = table[index[1]];
+                    row[i + 2] = table[index[2]];
+                    row[i + 3] = table[index[3]];
+                }
+
+                d2_4 = _mm_add_ps(d2_4, delta_4);
+                delta_4 = _mm_add_ps(delta_4, _mm_set1_ps(delta2));
+            }
+            _mm_storeu_ps(d2, d2_4);
+            _mm_storeu_ps(delta, delta_4);
+#endif
+            for (; i < n; i += 4) {
+                for (int j = 0; j < 4 && i + j < n; ++j) {
+                    const float t = tile_unit<TM>(approx_sqrt(std::max(d2[j], 0.0f)));
+                    row[i + j] = fSample ? fLUT.sampleReference(t)
+                                         : table[GradientLUT::Index(t)];
+                    d2[j] += delta[j];
+                    delta[j] += delta2;
+                }
+            }
+
+            row += n;
+            count -= n;
+            p.x += n * dx;
+            p.y += n * dy;
+        }
+    }
+
+public:
+    RadialGradient(GPoint center, float radius, const GColor colors[], const float pos[],
+                   int count, TileMode tileMode)
+        : fLUT(colors, count, pos)
+        , fUnit(radius, 0, center.x,
+                0, radius, center.y)
+        , fTileMode(tileMode) {}
+
+    bool isOpaque() override {
+        return fLUT.isOpaque();
+    }
+
+    /*
+     * t moves by at most the length of an inverse column per pixel. Only when it can move by
+     * less than an entry, so that neighboring pixels would share one, does blending the entries
+     * change anything; below that the nearest one is as good, and cheaper.
+     */
+    bool setContext(const GMatrix& ctm) override {
+        if (!(ctm * fUnit).invert(&fInverse)) {
+            return false;
+        }
+        const float step = std::min(fInverse[0] * fInverse[0] + fInverse[3] * fInverse[3],
+                                    fInverse[1] * fInverse[1] + fInverse[4] * fInverse[4]);
+        fSample = step * (GradientLUT::kSize - 1) * (GradientLUT::kSize - 1) < 1;
+        return true;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        G_STAT_ADD(fShadedPixels[GCanvasStats::kRadialGradient_ShaderType], count);
+        switch (fTileMode) {
+            case kClamp:  this->shade<kClamp>(x, y, count, row);  break;
+            case kRepeat: this->shade<kRepeat>(x, y, count, row); break;
+            case kMirror: this->shade<kMirror>(x, y, count, row); break;
+        }
+    }
+};
+
+std::unique_ptr<GShader> GCreateRadialGradient(GPoint center, float radius,
+                                               const GColor colors[], const float pos[],
+                                               int count, GShader::TileMode tileMode) {
+    if (count < 1 || !(radius > 0)) return nullptr;
+    return std::make_unique<RadialGradient>(center, radius, colors, pos, count, tileMode);
+}
+
+std::unique_ptr<GShader> GCreateRadialGradient(GPoint center, float radius,
+                                               const GColor colors[], int count,
+                                               GShader::TileMode tileMode) {
+    return GCreateRadialGradient(center, radius, colors, nullptr, count, tileMode);
+}
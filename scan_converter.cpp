@@ -6,8 +6,12 @@
 #include "include/GMath.h"
 #include "scan_converter.h"
 #include "edge.h"
+#include "stats.h"
+#include "trace.h"
 
 void ScanConverter::scan_rect(GIRect& rect, Blit& blit) {
+    G_STAT_ADD(fScanlines, std::max(rect.bottom - std::max(0, rect.top), 0));
+    G_STAT_ADD(fSpans, std::max(rect.bottom - std::max(0, rect.top), 0));
     for (int y = std::max(0, rect.top); y < rect.bottom; ++y) {
         blit.blit_horizontal(rect.left, rect.right, y);
     }
@@ -16,7 +20,10 @@ void ScanConverter::scan_rect(GIRect& rect, Blit& blit) {
 void ScanConverter::scan_convex(Edge *edges, int count, Blit& blit) {
     if (count < 2) return;
 
-    std::sort(edges, edges + count, compare_edge);
+    {
+        TracePhaseTimer trace(kSort_Phase);
+        std::sort(edges, edges + count, compare_edge);
+    }
 
     int y_last = edges[count - 1].y_min;
 
@@ -30,6 +37,8 @@ void ScanConverter::scan_convex(Edge *edges, int count, Blit& blit) {
 
     // iterate, and blit
     while (y_cur < y_last) {
+        G_STAT_ADD(fScanlines, 1);
+        G_STAT_ADD(fSpans, 1);
         blit.blit_horizontal(x_left, x_right, y_cur++);
 
         if (left->y_min <= y_cur) {
@@ -87,12 +96,16 @@ void ScanConverter::scan_convex(Edge *edges, int count, Blit& blit) {
 void ScanConverter::scan_complex(Edge *edges, int count, Blit &blit) {
     if (count < 2) return;
 
-    std::sort(edges, edges + count, compare_edge);
+    {
+        TracePhaseTimer trace(kSort_Phase);
+        std::sort(edges, edges + count, compare_edge);
+    }
 
     int y = edges->y_max;
 
     while (count > 0) {
         int curr = 0, x0 = 0, x1, winding = 0;
+        G_STAT_ADD(fScanlines, 1);
 
         while (curr < count && edges[curr].y_max <= y) {
             if (winding == 0)
@@ -102,11 +115,12 @@ void ScanConverter::scan_complex(Edge *edges, int count, Blit &blit) {
 
             if (winding == 0) {
                 x1 = GRoundToInt(edges[curr].cur_x);
+                G_STAT_ADD(fSpans, 1);
                 blit.blit_horizontal(x0, x1, y);
             }
 
             if (y + 1 >= edges[curr].y_min) {
-                memcpy(&edges[curr], &edges[curr + 1], sizeof(Edge) * (count - curr));
+                memmove(&edges[curr], &edges[curr + 1], sizeof(Edge) * (count - curr - 1));
                 count--;
             } else {
                 edges[curr].cur_x += edges[curr].m;
@@ -118,6 +132,7 @@ void ScanConverter::scan_complex(Edge *edges, int count, Blit &blit) {
 
         while (curr < count && y == edges[curr].y_max) curr++;
 
+        TraceSampledTimer trace(kSort_Phase);
         std::sort(edges, edges + curr, [](const Edge& a, const Edge& b) -> bool {
             return a.cur_x < b.cur_x;
         });
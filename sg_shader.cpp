@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "include/GMatrix.h"
+#include "include/GShader.h"
+#include "include/GPixel.h"
+#include "include/GPoint.h"
+#include "gradient.h"
+#include "reference.h"
+#include "stats.h"
+#include "utils.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/*
+ * atan2, in turns ([0, 1), counterclockwise from +x, so clockwise on screen), without libm.
+ *
+ * The octant is folded away first, leaving atan(s) for s = min/max in [0, 1], which an odd
+ * polynomial approximates to within 1e-5 radians (so under 2e-6 of a turn, well below one step
+ * of the 256 entry color table). The polynomial is written in turns, and unfolded with selects
+ * instead of branches so that the vector version below does exactly the same float ops.
+ */
+constexpr float kAtanC1 =  0.99997726f / (2 * 3.14159265f);
+constexpr float kAtanC3 = -0.33262347f / (2 * 3.14159265f);
+constexpr float kAtanC5 =  0.19354346f / (2 * 3.14159265f);
+constexpr float kAtanC7 = -0.11643287f / (2 * 3.14159265f);
+constexpr float kAtanC9 =  0.05265332f / (2 * 3.14159265f);
+constexpr float kAtanC11 = -0.01172120f / (2 * 3.14159265f);
+
+static inline float atan_turns(float s) {
+    const float s2 = s * s;
+    return s * (kAtanC1 + s2 * (kAtanC3 + s2 * (kAtanC5 + s2 * (kAtanC7 + s2 * (kAtanC9 +
+                s2 * kAtanC11)))));
+}
+
+static inline float atan2_turns(float y, float x) {
+    const float ax = fabsf(x), ay = fabsf(y);
+    const float hi = std::max(ax, ay), lo = std::min(ax, ay);
+    float r = atan_turns(hi > 0 ? lo / hi : 0);
+    r = ay > ax ? 0.25f - r : r;
+    r = x < 0 ? 0.5f - r : r;
+    r = y < 0 ? 1.0f - r : r;
+    return r < 1.0f ? r : 0.0f;     // -0 and rounding can land exactly on 1
+}
+
+#if defined(__SSE2__)
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 atan_turns(__m128 s) {
+    const __m128 s2 = _mm_mul_ps(s, s);
+    __m128 r = _mm_set1_ps(kAtanC11);
+    r = _mm_add_ps(_mm_set1_ps(kAtanC9), _mm_mul_ps(s2, r));
+    r = _mm_add_ps(_mm_set1_ps(kAtanC7), _mm_mul_ps(s2, r));
+    r = _mm_add_ps(_mm_set1_ps(kAtanC5), _mm_mul_ps(s2, r));
+    r = _mm_add_ps(_mm_set1_ps(kAtanC3), _mm_mul_ps(s2, r));
+    r = _mm_add_ps(_mm_set1_ps(kAtanC1), _mm_mul_ps(s2, r));
+    return _mm_mul_ps(s, r);
+}
+
+static inline __m128 atan2_turns(__m128 y, __m128 x) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 ax = _mm_andnot_ps(sign, x), ay = _mm_andnot_ps(sign, y);
+    const __m128 hi = _mm_max_ps(ax, ay), lo = _mm_min_ps(ax, ay);
+
+    // where hi == 0 the division is 0/0, and the select drops its NaN
+    __m128 r = atan_turns(select(_mm_cmpgt_ps(hi, zero), _mm_div_ps(lo, hi), zero));
+    r = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(0.25f), r), r);
+    r = select(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(0.5f), r), r);
+    r = select(_mm_cmplt_ps(y, zero), _mm_sub_ps(_mm_set1_ps(1.0f), r), r);
+    return select(_mm_cmplt_ps(r, _mm_set1_ps(1.0f)), r, zero);
+}
+#endif
+
+class SweepGradient : public GShader {
+private:
+    GradientLUT fLUT;
+    GMatrix fInverse;
+    GMatrix fUnit;
+
+public:
+    SweepGradient(GPoint center, float startRadians, const GColor colors[], const float pos[],
+                  int count)
+        : fLUT(colors, count, pos)
+        , fUnit(GMatrix::Translate(center.x, center.y) * GMatrix::Rotate(startRadians)) {}
+
+    bool isOpaque() override {
+        return fLUT.isOpaque();
+    }
+
+    bool setContext(const GMatrix& ctm) override {
+        return (ctm * fUnit).invert(&fInverse);
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        G_STAT_ADD(fShadedPixels[GCanvasStats::kSweepGradient_ShaderType], count);
+
+        const GPoint p = fInverse * GPoint{x + .5f, y + .5f};
+        const float dx = fInverse[0];
+        const float dy = fInverse[3];
+
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128 lane = _mm_setr_ps(0, 1, 2, 3);
+        for (; !gReferenceBackend && i + 4 <= count; i += 4) {
+            const __m128 n = _mm_add_ps(_mm_set1_ps((float)i), lane);
+            const __m128 px = _mm_add_ps(_mm_set1_ps(p.x), _mm_mul_ps(n, _mm_set1_ps(dx)));
+            const __m128 py = _mm_add_ps(_mm_set1_ps(p.y), _mm_mul_ps(n, _mm_set1_ps(dy)));
+            fLUT.sample4(atan2_turns(py, px), row + i);
+        }
+#endif
+        for (; i < count; ++i) {
+            const float px = p.x + (float)i * dx;
+            const float py = p.y + (float)i * dy;
+            row[i] = fLUT.sampleReference(atan2_turns(py, px));
+        }
+    }
+};
+
+std::unique_ptr<GShader> GCreateSweepGradient(GPoint center, float startRadians,
+                                              const GColor colors[], const float pos[],
+                                              int count) {
+    if (count < 1) return nullptr;
+    return std::make_unique<SweepGradient>(center, startRadians, colors, pos, count);
+}
+
+std::unique_ptr<GShader> GCreateSweepGradient(GPoint center, float startRadians,
+                                              const GColor colors[], int count) {
+    return GCreateSweepGradient(center, startRadians, colors, nullptr, count);
+}
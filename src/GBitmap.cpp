@@ -4,6 +4,8 @@
 
 #include "../include/GBitmap.h"
 
+#include <sys/mman.h>
+
 void GBitmap::setIsOpaque(IsOpaque io) {
     switch (io) {
         case kYes_IsOpaque: fIsOpaque = true;  break;
@@ -47,3 +49,49 @@ void GBitmap::alloc(int w, int h, size_t rb) {
                 (w > 0 && h > 0) ? (GPixel*)calloc(h, rb) : nullptr,
                 kNo_IsOpaque);
 }
+
+constexpr size_t kRowAlign     = 64;                 // a cache line, and the widest SIMD store
+constexpr size_t kPageSize     = 4096;
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+static size_t aligned_row_bytes(int w) {
+    size_t rb = (w * sizeof(GPixel) + kRowAlign - 1) & ~(kRowAlign - 1);
+    // With a stride that is a multiple of the page size, every row maps onto the same L1 sets
+    // (and 4K-aliases against its neighbors), so nudge it off by a cache line.
+    if (rb % kPageSize == 0) {
+        rb += kRowAlign;
+    }
+    return rb;
+}
+
+void GBitmap::alloc(int w, int h, AllocMode mode) {
+    if (mode == kPacked_AllocMode) {
+        this->alloc(w, h);
+        return;
+    }
+
+    assert(w >= 0);
+    assert(h >= 0);
+    size_t rb = aligned_row_bytes(w);
+
+    GPixel* pixels = nullptr;
+    if (w > 0 && h > 0) {
+        const size_t size = h * rb;
+        const bool huge = mode == kHugePage_AllocMode && size >= kHugePageSize;
+
+        void* mem;
+        if (!posix_memalign(&mem, huge ? kHugePageSize : kRowAlign, size)) {
+#ifdef MADV_HUGEPAGE
+            if (huge) {
+                // only a hint: if THP is disabled we silently get normal pages
+                (void)madvise(mem, size, MADV_HUGEPAGE);
+            }
+#endif
+            // zero after the hint, so that the first touch can fault in huge pages
+            memset(mem, 0, size);
+            pixels = (GPixel*)mem;
+        }
+    }
+
+    this->reset(w, h, rb, pixels, kNo_IsOpaque);
+}
@@ -3,29 +3,9 @@
  */
 
 #include "../include/GBitmap.h"
+#include "GPixelConvert.h"
 #include "lodepng.h"
 
-static void convertToPNG(const GPixel src[], int width, uint8_t dst[]) {
-    for (int i = 0; i < width; i++) {
-        GPixel c = *src++;
-        int a = GPixel_GetA(c);
-        int r = GPixel_GetR(c);
-        int g = GPixel_GetG(c);
-        int b = GPixel_GetB(c);
-        
-        // PNG requires unpremultiplied, but GPixel is premultiplied
-        if (0 != a && 255 != a) {
-            r = (r * 255 + a/2) / a;
-            g = (g * 255 + a/2) / a;
-            b = (b * 255 + a/2) / a;
-        }
-        *dst++ = r;
-        *dst++ = g;
-        *dst++ = b;
-        *dst++ = a;
-    }
-}
-
 bool GBitmap::writeToFile(const char path[]) const {
     size_t rb = this->width() * 4;
     uint8_t* pix = (uint8_t*)malloc(this->height() * rb);
@@ -36,7 +16,7 @@ bool GBitmap::writeToFile(const char path[]) const {
     const GPixel* src = this->pixels();
     uint8_t* dst = pix;
     for (int y = 0; y < this->height(); ++y) {
-        convertToPNG(src, this->width(), dst);
+        convert_row_to_rgba(src, this->width(), dst);
         src += this->rowBytes() / 4;
         dst += rb;
     }
@@ -48,26 +28,57 @@ bool GBitmap::writeToFile(const char path[]) const {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static int alpha_mul(unsigned a, unsigned c) {
-    return (a * c + 127) / 255;
+enum FileFormat {
+    kPNG_FileFormat,
+    kQOI_FileFormat,
+    kRaw_FileFormat,
+};
+
+static FileFormat sniff_format(const char path[]) {
+    char magic[4] = {};
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        size_t n = fread(magic, 1, sizeof(magic), f);
+        (void)n;
+        fclose(f);
+    }
+    if (!memcmp(magic, "qoif", 4)) {
+        return kQOI_FileFormat;
+    }
+    if (!memcmp(magic, "GBMP", 4)) {
+        return kRaw_FileFormat;
+    }
+    return kPNG_FileFormat;
 }
 
-static void swizzle_rgba_row(GPixel dst[], const uint8_t src[], int count) {
-    for (int i = 0; i < count; ++i) {
-        unsigned a = src[3];
-        dst[i] = GPixel_PackARGB(a,
-                                 alpha_mul(a, src[0]),
-                                 alpha_mul(a, src[1]),
-                                 alpha_mul(a, src[2]));
-        src += 4;
+static bool read_raw_file(GBitmap* bitmap, const char path[]) {
+    GBitmap mapped;
+    if (!mapped.mapRawFile(path)) {
+        bitmap->reset();
+        return false;
     }
+
+    bitmap->alloc(mapped.width(), mapped.height());
+    for (int y = 0; y < mapped.height(); ++y) {
+        memcpy(bitmap->getAddr(0, y), mapped.getAddr(0, y), mapped.width() * sizeof(GPixel));
+    }
+    bitmap->setIsOpaque(mapped.isOpaque() ? GBitmap::kYes_IsOpaque : GBitmap::kNo_IsOpaque);
+    mapped.unmapRawFile();
+    return true;
 }
 
 bool GBitmap::readFromFile(const char path[]) {
+    switch (sniff_format(path)) {
+        case kQOI_FileFormat: return this->readFromQOIFile(path);
+        case kRaw_FileFormat: return read_raw_file(this, path);
+        case kPNG_FileFormat: break;
+    }
+
     unsigned w, h;
     unsigned char* pix = nullptr;
     if (lodepng_decode32_file(&pix, &w, &h, path)) {
         free(pix);
+        this->reset();
         return false;
     }
 
@@ -77,7 +88,7 @@ bool GBitmap::readFromFile(const char path[]) {
     const uint8_t* src = pix;
     size_t rb = w * 4;
     for (unsigned y = 0; y < h; ++y) {
-        swizzle_rgba_row(dst, src, w);
+        convert_row_from_rgba(dst, src, w);
         src += rb;
         dst += this->rowBytes() / 4;
     }
@@ -86,5 +97,3 @@ bool GBitmap::readFromFile(const char path[]) {
     this->setIsOpaque(kCompute_IsOpaque);
     return true;
 }
-
-
@@ -0,0 +1,237 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+#include "GPixelConvert.h"
+
+/*
+ *  "Quite OK Image" format, see https://qoiformat.org/qoi-specification.pdf
+ *
+ *  QOI stores unpremultiplied R,G,B,A, so we convert a row at a time through the same row
+ *  converters as the PNG path.
+ */
+
+enum {
+    QOI_OP_INDEX = 0x00,    // 00xxxxxx
+    QOI_OP_DIFF  = 0x40,    // 01xxxxxx
+    QOI_OP_LUMA  = 0x80,    // 10xxxxxx
+    QOI_OP_RUN   = 0xC0,    // 11xxxxxx
+    QOI_OP_RGB   = 0xFE,
+    QOI_OP_RGBA  = 0xFF,
+
+    QOI_MASK_2   = 0xC0,
+};
+
+constexpr int kQOIHeaderSize = 14;
+constexpr uint8_t kQOIPadding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct QOIColor {
+    uint8_t r, g, b, a;
+
+    bool operator==(const QOIColor& c) const {
+        return r == c.r && g == c.g && b == c.b && a == c.a;
+    }
+    bool operator!=(const QOIColor& c) const { return !(*this == c); }
+};
+
+static inline int qoi_hash(const QOIColor& c) {
+    return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) & 63;
+}
+
+static void write_u32_be(std::vector<uint8_t>* out, uint32_t v) {
+    out->push_back(v >> 24);
+    out->push_back(v >> 16);
+    out->push_back(v >> 8);
+    out->push_back(v);
+}
+
+static uint32_t read_u32_be(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+bool GBitmap::writeToQOIFile(const char path[]) const {
+    const int w = this->width();
+    const int h = this->height();
+    if (w <= 0 || h <= 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(kQOIHeaderSize + (size_t)w * h * 2 + sizeof(kQOIPadding));
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    write_u32_be(&out, w);
+    write_u32_be(&out, h);
+    out.push_back(4);   // channels
+    out.push_back(0);   // sRGB with linear alpha
+
+    QOIColor index[64] = {};
+    QOIColor prev = {0, 0, 0, 255};
+    int run = 0;
+
+    std::vector<uint8_t> rgba(w * 4);
+    for (int y = 0; y < h; ++y) {
+        convert_row_to_rgba(this->getAddr(0, y), w, rgba.data());
+
+        for (int x = 0; x < w; ++x) {
+            const uint8_t* p = &rgba[x * 4];
+            QOIColor px = {p[0], p[1], p[2], p[3]};
+
+            if (px == prev) {
+                if (++run == 62) {
+                    out.push_back(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.push_back(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            const int hash = qoi_hash(px);
+            if (index[hash] == px) {
+                out.push_back(QOI_OP_INDEX | hash);
+            } else {
+                index[hash] = px;
+
+                if (px.a == prev.a) {
+                    const int8_t vr = px.r - prev.r;
+                    const int8_t vg = px.g - prev.g;
+                    const int8_t vb = px.b - prev.b;
+                    const int8_t vg_r = vr - vg;
+                    const int8_t vg_b = vb - vg;
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        out.push_back(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 &&
+                               vg_b > -9 && vg_b < 8) {
+                        out.push_back(QOI_OP_LUMA | (vg + 32));
+                        out.push_back((vg_r + 8) << 4 | (vg_b + 8));
+                    } else {
+                        out.insert(out.end(), {QOI_OP_RGB, px.r, px.g, px.b});
+                    }
+                } else {
+                    out.insert(out.end(), {QOI_OP_RGBA, px.r, px.g, px.b, px.a});
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0) {
+        out.push_back(QOI_OP_RUN | (run - 1));
+    }
+    out.insert(out.end(), kQOIPadding, kQOIPadding + sizeof(kQOIPadding));
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return (fclose(f) == 0) && ok;
+}
+
+static bool read_entire_file(const char path[], std::vector<uint8_t>* data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    bool ok = !fseek(f, 0, SEEK_END);
+    long size = ok ? ftell(f) : -1;
+    ok = size >= 0 && !fseek(f, 0, SEEK_SET);
+    if (ok) {
+        data->resize(size);
+        ok = fread(data->data(), 1, size, f) == (size_t)size;
+    }
+    fclose(f);
+    return ok;
+}
+
+bool GBitmap::readFromQOIFile(const char path[]) {
+    this->reset();
+
+    std::vector<uint8_t> data;
+    if (!read_entire_file(path, &data) ||
+        data.size() < kQOIHeaderSize + sizeof(kQOIPadding) ||
+        memcmp(data.data(), "qoif", 4)) {
+        return false;
+    }
+
+    const uint32_t w = read_u32_be(&data[4]);
+    const uint32_t h = read_u32_be(&data[8]);
+    const uint8_t channels = data[12];
+    // refuse anything that would not fit in a GBitmap (256M pixels max)
+    if (w == 0 || h == 0 || (uint64_t)w * h > (1 << 28) || (channels != 3 && channels != 4)) {
+        return false;
+    }
+
+    this->alloc(w, h);
+    if (!this->pixels()) {
+        this->reset();
+        return false;
+    }
+
+    auto fail = [this]() {
+        free(this->pixels());
+        this->reset();
+        return false;
+    };
+
+    QOIColor index[64] = {};
+    QOIColor px = {0, 0, 0, 255};
+    int run = 0;
+
+    const uint8_t* p = &data[kQOIHeaderSize];
+    const uint8_t* stop = data.data() + data.size() - sizeof(kQOIPadding);
+
+    std::vector<uint8_t> rgba(w * 4);
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            if (run > 0) {
+                run--;
+            } else if (p < stop) {
+                const int b1 = *p++;
+
+                if (b1 == QOI_OP_RGB) {
+                    if (stop - p < 3) return fail();
+                    px.r = p[0];
+                    px.g = p[1];
+                    px.b = p[2];
+                    p += 3;
+                } else if (b1 == QOI_OP_RGBA) {
+                    if (stop - p < 4) return fail();
+                    px = {p[0], p[1], p[2], p[3]};
+                    p += 4;
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                    px = index[b1];
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                    px.r += ((b1 >> 4) & 3) - 2;
+                    px.g += ((b1 >> 2) & 3) - 2;
+                    px.b += ( b1       & 3) - 2;
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                    const int b2 = *p++;
+                    const int vg = (b1 & 0x3F) - 32;
+                    px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                    px.g += vg;
+                    px.b += vg - 8 + (b2 & 0x0F);
+                } else {
+                    run = b1 & 0x3F;
+                }
+
+                index[qoi_hash(px)] = px;
+            } else {
+                return fail();
+            }
+
+            uint8_t* dst = &rgba[x * 4];
+            dst[0] = px.r;
+            dst[1] = px.g;
+            dst[2] = px.b;
+            dst[3] = px.a;
+        }
+        convert_row_from_rgba(this->getAddr(0, y), rgba.data(), w);
+    }
+
+    this->setIsOpaque(kCompute_IsOpaque);
+    return true;
+}
@@ -0,0 +1,123 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "../include/GBitmap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ *  Raw bitmap layout:
+ *
+ *  [0 .. 64)   RawHeader
+ *  [64 .. )    height rows of premultiplied GPixels, each row padded to fRowBytes
+ *
+ *  fRowBytes is a multiple of 64, and the pixels start 64 bytes into the (page aligned) mapping,
+ *  so every row of a mapped bitmap starts on a cache line.
+ */
+
+constexpr uint32_t kRawVersion   = 1;
+constexpr uint32_t kRawByteOrder = 0x01020304;    // GPixels are stored in native order
+constexpr uint32_t kRawOpaqueFlag = 1 << 0;
+constexpr size_t   kRawAlign     = 64;
+
+struct RawHeader {
+    char     fMagic[4];     // "GBMP"
+    uint32_t fVersion;
+    uint32_t fByteOrder;
+    int32_t  fWidth;
+    int32_t  fHeight;
+    uint32_t fRowBytes;
+    uint32_t fFlags;
+    uint8_t  fReserved[36];
+};
+static_assert(sizeof(RawHeader) == kRawAlign, "pixels must start on a cache line");
+
+static size_t raw_row_bytes(int width) {
+    size_t rb = width * sizeof(GPixel);
+    return (rb + kRawAlign - 1) & ~(kRawAlign - 1);
+}
+
+static size_t raw_file_size(const RawHeader& header) {
+    return sizeof(RawHeader) + (size_t)header.fHeight * header.fRowBytes;
+}
+
+static bool valid_header(const RawHeader& header) {
+    return !memcmp(header.fMagic, "GBMP", 4) &&
+           header.fVersion == kRawVersion &&
+           header.fByteOrder == kRawByteOrder &&
+           header.fWidth > 0 && header.fHeight > 0 &&
+           header.fRowBytes == raw_row_bytes(header.fWidth);
+}
+
+bool GBitmap::writeToRawFile(const char path[]) const {
+    RawHeader header = {};
+    memcpy(header.fMagic, "GBMP", 4);
+    header.fVersion = kRawVersion;
+    header.fByteOrder = kRawByteOrder;
+    header.fWidth = this->width();
+    header.fHeight = this->height();
+    header.fRowBytes = raw_row_bytes(this->width());
+    header.fFlags = this->isOpaque() ? kRawOpaqueFlag : 0;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    const size_t pixelBytes = this->width() * sizeof(GPixel);
+    const uint8_t zeros[kRawAlign] = {};
+    for (int y = 0; ok && y < this->height(); ++y) {
+        ok = fwrite(this->getAddr(0, y), 1, pixelBytes, f) == pixelBytes;
+        size_t pad = header.fRowBytes - pixelBytes;
+        if (ok && pad) {
+            ok = fwrite(zeros, 1, pad, f) == pad;
+        }
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+bool GBitmap::mapRawFile(const char path[]) {
+    this->reset();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    RawHeader header;
+    struct stat st;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !valid_header(header) ||
+        fstat(fd, &st) || (size_t)st.st_size != raw_file_size(header)) {
+        close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file alive
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    GPixel* pixels = (GPixel*)((char*)base + sizeof(RawHeader));
+    // Trust the flag instead of scanning every (possibly not yet paged in) pixel.
+    fWidth = header.fWidth;
+    fHeight = header.fHeight;
+    fRowBytes = header.fRowBytes;
+    fPixels = pixels;
+    fIsOpaque = (header.fFlags & kRawOpaqueFlag) != 0;
+    return true;
+}
+
+void GBitmap::unmapRawFile() {
+    if (fPixels) {
+        char* base = (char*)fPixels - sizeof(RawHeader);
+        munmap(base, sizeof(RawHeader) + (size_t)fHeight * fRowBytes);
+    }
+    this->reset();
+}
@@ -0,0 +1,146 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include "GPixelConvert.h"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/*
+ *  Unpremul is c' = (c * 255 + a/2) / a. Rather than three integer divides per pixel we multiply
+ *  by a per-alpha reciprocal of 255/a, nudged up by one part in 2^22 so that every c <= a rounds
+ *  exactly as the divide does (tests_bitmap.cpp checks all of them). a == 0 maps to 0, which
+ *  is what a valid premul pixel holds anyway.
+ */
+static const std::array<float, 256> gUnpremulScale = []() {
+    std::array<float, 256> table = {};
+    for (int a = 1; a < 256; ++a) {
+        table[a] = (255.0f / a) * (1.0f + 0x1p-22f);
+    }
+    return table;
+}();
+
+// Invalid premul (c > a) scales past 255, which the cast cannot hold; pin it, as the SSE2 packs do.
+static inline uint8_t unpremul(unsigned c, float scale) {
+    return (uint8_t)std::min(c * scale + 0.5f, 255.0f);
+}
+
+// (a * c + 127) / 255, computed without a divide; exact for all 8-bit a and c.
+static inline unsigned premul(unsigned a, unsigned c) {
+    unsigned v = a * c + 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+void convert_row_to_rgba_scalar(const GPixel src[], int count, uint8_t dst[]) {
+    for (int i = 0; i < count; i++) {
+        GPixel c = *src++;
+        int a = GPixel_GetA(c);
+        float scale = gUnpremulScale[a];
+
+        *dst++ = unpremul(GPixel_GetR(c), scale);
+        *dst++ = unpremul(GPixel_GetG(c), scale);
+        *dst++ = unpremul(GPixel_GetB(c), scale);
+        *dst++ = a;
+    }
+}
+
+void convert_row_from_rgba_scalar(GPixel dst[], const uint8_t src[], int count) {
+    for (int i = 0; i < count; ++i) {
+        unsigned a = src[3];
+        dst[i] = GPixel_PackARGB(a, premul(a, src[0]), premul(a, src[1]), premul(a, src[2]));
+        src += 4;
+    }
+}
+
+#if defined(__SSE2__)
+
+// Swaps 16 bit lanes 0 and 2 of each 4-lane group: R,G,B,A <-> B,G,R,A
+static inline __m128i swap_rb_16(__m128i v) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 0, 1, 2));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+void convert_row_to_rgba(const GPixel src[], int count, uint8_t dst[]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i));
+
+        const __m128 scales = _mm_setr_ps(gUnpremulScale[src[i + 0] >> 24],
+                                          gUnpremulScale[src[i + 1] >> 24],
+                                          gUnpremulScale[src[i + 2] >> 24],
+                                          gUnpremulScale[src[i + 3] >> 24]);
+
+        // widen to one pixel per register, 32 bits per channel (B,G,R,A)
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        __m128i p0 = _mm_unpacklo_epi16(lo, zero);
+        __m128i p1 = _mm_unpackhi_epi16(lo, zero);
+        __m128i p2 = _mm_unpacklo_epi16(hi, zero);
+        __m128i p3 = _mm_unpackhi_epi16(hi, zero);
+
+        auto scale = [&](__m128i p, __m128 s) {
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(p), s), half));
+        };
+        p0 = scale(p0, _mm_shuffle_ps(scales, scales, _MM_SHUFFLE(0, 0, 0, 0)));
+        p1 = scale(p1, _mm_shuffle_ps(scales, scales, _MM_SHUFFLE(1, 1, 1, 1)));
+        p2 = scale(p2, _mm_shuffle_ps(scales, scales, _MM_SHUFFLE(2, 2, 2, 2)));
+        p3 = scale(p3, _mm_shuffle_ps(scales, scales, _MM_SHUFFLE(3, 3, 3, 3)));
+
+        lo = swap_rb_16(_mm_packs_epi32(p0, p1));
+        hi = swap_rb_16(_mm_packs_epi32(p2, p3));
+        __m128i rgba = _mm_packus_epi16(lo, hi);
+
+        // the alpha lanes were scaled too; put the originals back
+        rgba = _mm_or_si128(_mm_andnot_si128(alpha, rgba), _mm_and_si128(alpha, px));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), rgba);
+    }
+    convert_row_to_rgba_scalar(src + i, count - i, dst + i * 4);
+}
+
+void convert_row_from_rgba(GPixel dst[], const uint8_t src[], int count) {
+    const __m128i zero = _mm_setzero_si128();
+    // multiply R,G,B by A, and A by 255 (which the divide turns back into A)
+    const __m128i keep_rgb = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alpha_255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i bias = _mm_set1_epi16(128);
+
+    auto premul_2 = [&](__m128i c) {
+        c = swap_rb_16(c);
+        __m128i a = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm_or_si128(_mm_and_si128(a, keep_rgb), alpha_255);
+
+        __m128i v = _mm_add_epi16(_mm_mullo_epi16(c, a), bias);
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    };
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i lo = premul_2(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = premul_2(_mm_unpackhi_epi8(px, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    convert_row_from_rgba_scalar(dst + i, src + i * 4, count - i);
+}
+
+#else
+
+void convert_row_to_rgba(const GPixel src[], int count, uint8_t dst[]) {
+    convert_row_to_rgba_scalar(src, count, dst);
+}
+
+void convert_row_from_rgba(GPixel dst[], const uint8_t src[], int count) {
+    convert_row_from_rgba_scalar(dst, src, count);
+}
+
+#endif
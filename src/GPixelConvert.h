@@ -0,0 +1,27 @@
+/**
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef GPixelConvert_DEFINED
+#define GPixelConvert_DEFINED
+
+#include "../include/GPixel.h"
+
+/*
+ *  Row converters between our premultiplied GPixels and the unpremultiplied R,G,B,A byte order
+ *  used by the file formats (PNG, QOI). Anything that imports or exports pixels should go
+ *  through these.
+ *
+ *  The default versions use SSE2 when it is available (always, on x86-64); the _scalar versions
+ *  are the reference they must match exactly.
+ */
+
+// premul GPixel -> unpremul RGBA
+void convert_row_to_rgba(const GPixel src[], int count, uint8_t dst[]);
+void convert_row_to_rgba_scalar(const GPixel src[], int count, uint8_t dst[]);
+
+// unpremul RGBA -> premul GPixel
+void convert_row_from_rgba(GPixel dst[], const uint8_t src[], int count);
+void convert_row_from_rgba_scalar(GPixel dst[], const uint8_t src[], int count);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "include/GCanvasStats.h"
+#include "include/GPixel.h"
+
+/*
+ * Instrumentation for the raster pipeline. With G_STATS defined, a canvas points gStats at its
+ * GCanvasStats for the duration of each draw (see StatsScope) and the G_STAT_* macros add to
+ * it. Without G_STATS the macros expand to nothing and StatsScope is empty.
+ */
+#ifdef G_STATS
+
+extern thread_local GCanvasStats* gStats;
+
+class StatsScope {
+private:
+    GCanvasStats* fPrev;
+public:
+    explicit StatsScope(GCanvasStats* stats) : fPrev(gStats) { gStats = stats; }
+    ~StatsScope() { gStats = fPrev; }
+};
+
+static inline int alpha_class(unsigned alpha) {
+    if (alpha == 0) return GCanvasStats::kTransparent_AlphaClass;
+    if (alpha == 0xFF) return GCanvasStats::kOpaque_AlphaClass;
+    return GCanvasStats::kPartial_AlphaClass;
+}
+
+static inline void stat_blit_row(GBlendMode mode, const GPixel src[], int count) {
+    uint64_t* classes = gStats->fBlitPixels[(int) mode];
+    for (int i = 0; i < count; ++i) {
+        classes[alpha_class(GPixel_GetA(src[i]))]++;
+    }
+}
+
+#define G_STAT_ADD(field, n) \
+    do { if (gStats) gStats->field += (n); } while (0)
+
+// count pixels blended with the same src
+#define G_STAT_BLIT_SOLID(mode, src, count) \
+    G_STAT_ADD(fBlitPixels[(int) (mode)][alpha_class(GPixel_GetA(src))], count)
+
+// count pixels blended with a row of src pixels
+#define G_STAT_BLIT_ROW(mode, src, count) \
+    do { if (gStats) stat_blit_row(mode, src, count); } while (0)
+
+#else
+
+class StatsScope {
+public:
+    explicit StatsScope(GCanvasStats*) {}
+};
+
+#define G_STAT_ADD(field, n)                do {} while (0)
+#define G_STAT_BLIT_SOLID(mode, src, count) do {} while (0)
+#define G_STAT_BLIT_ROW(mode, src, count)   do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "trace.h"
+
+std::atomic<bool> gTraceEnabled{false};
+thread_local TraceEvent* gTraceEvent = nullptr;
+
+/*
+ * One per thread that has drawn while tracing, linked into gRings and never freed, so the events
+ * of threads that have exited can still be written out. Only the owning thread writes to a ring;
+ * GTraceEnd reads it once the draws are done.
+ */
+struct TraceRing {
+    std::vector<TraceEvent> fEvents;    // power of 2 sized
+    std::atomic<uint64_t> fHead{0};     // events written this session
+    uint64_t fSession = 0;
+    int fTid = 0;
+    TraceRing* fNext = nullptr;
+};
+
+static std::atomic<TraceRing*> gRings{nullptr};
+static std::atomic<int> gNextTid{1};
+static std::atomic<uint64_t> gSession{0};
+static std::atomic<int> gCapacity{1 << 16};
+static GNSec gSessionStart = 0;
+
+static TraceRing* this_thread_ring() {
+    thread_local TraceRing* ring = nullptr;
+    if (!ring) {
+        ring = new TraceRing;
+        ring->fTid = gNextTid.fetch_add(1, std::memory_order_relaxed);
+        // lock free push onto the list of rings
+        TraceRing* head = gRings.load(std::memory_order_relaxed);
+        do {
+            ring->fNext = head;
+        } while (!gRings.compare_exchange_weak(head, ring, std::memory_order_release,
+                                               std::memory_order_relaxed));
+    }
+    return ring;
+}
+
+static void record(const TraceEvent& event) {
+    TraceRing* ring = this_thread_ring();
+
+    const uint64_t session = gSession.load(std::memory_order_acquire);
+    if (ring->fSession != session) {
+        // the first event of a new trace on this thread: start over
+        int capacity = 1;
+        while (capacity < gCapacity.load(std::memory_order_relaxed)) {
+            capacity <<= 1;
+        }
+        ring->fEvents.assign(capacity, TraceEvent());
+        ring->fHead.store(0, std::memory_order_relaxed);
+        ring->fSession = session;
+    }
+
+    uint64_t head = ring->fHead.load(std::memory_order_relaxed);
+    ring->fEvents[head & (ring->fEvents.size() - 1)] = event;
+    ring->fHead.store(head + 1, std::memory_order_release);
+}
+
+TraceScope::~TraceScope() {
+    if (!fActive) {
+        return;
+    }
+    gTraceEvent = nullptr;
+    fEvent.fDuration = GTime::GetNSec() - fEvent.fStart;
+
+    // sampled phases: entries 0, interval, 2 * interval... were timed; scale to all the entries
+    for (int p = 0; p < kTracePhaseCount; ++p) {
+        if (const uint64_t entries = fEvent.fEntries[p]) {
+            const uint64_t timed = (entries + kTraceSampleInterval - 1) / kTraceSampleInterval;
+            fEvent.fPhases[p] += (GNSec) ((double) fEvent.fSampled[p] * entries / timed);
+        }
+    }
+
+    // sort and blit run inside the scan converter
+    GNSec nested = fEvent.fPhases[kSort_Phase] + fEvent.fPhases[kBlit_Phase];
+    GNSec& scan = fEvent.fPhases[kScan_Phase];
+    scan = scan > nested ? scan - nested : 0;
+
+    if (fEvent.fPixels == 0) {
+        fEvent.fLeft = fEvent.fTop = fEvent.fRight = fEvent.fBottom = 0;
+    }
+    record(fEvent);
+}
+
+void GTraceBegin(int eventsPerThread) {
+    gCapacity.store(std::max(eventsPerThread, 1), std::memory_order_relaxed);
+    gSessionStart = GTime::GetNSec();
+    gSession.fetch_add(1, std::memory_order_release);
+    gTraceEnabled.store(true, std::memory_order_release);
+}
+
+bool GTraceEnd(const char path[]) {
+    gTraceEnabled.store(false, std::memory_order_release);
+    const uint64_t session = gSession.load(std::memory_order_acquire);
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    static const char* gPhaseNames[kTracePhaseCount] = {
+        "transform", "clip", "sort", "scan", "blit",
+    };
+
+    fprintf(f, "{\"traceEvents\": [\n");
+    bool first = true;
+    for (TraceRing* ring = gRings.load(std::memory_order_acquire); ring; ring = ring->fNext) {
+        if (ring->fSession != session) {
+            continue;
+        }
+        const uint64_t head = ring->fHead.load(std::memory_order_acquire);
+        const uint64_t count = std::min<uint64_t>(head, ring->fEvents.size());
+
+        for (uint64_t i = head - count; i < head; ++i) {
+            const TraceEvent& e = ring->fEvents[i & (ring->fEvents.size() - 1)];
+            // timestamps are in microseconds from GTraceBegin
+            fprintf(f, "%s  {\"name\": \"%s\", \"cat\": \"draw\", \"ph\": \"X\", "
+                       "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {"
+                       "\"vertices\": %d, \"edges\": %d, \"bounds\": [%d, %d, %d, %d], "
+                       "\"pixels\": %llu",
+                    first ? "" : ",\n", e.fOp,
+                    (e.fStart - gSessionStart) * 1e-3, e.fDuration * 1e-3, ring->fTid,
+                    e.fVertices, e.fEdges, e.fLeft, e.fTop, e.fRight, e.fBottom,
+                    (unsigned long long)e.fPixels);
+            for (int p = 0; p < kTracePhaseCount; ++p) {
+                fprintf(f, ", \"%s_us\": %.3f", gPhaseNames[p], e.fPhases[p] * 1e-3);
+            }
+            fprintf(f, "}}");
+            first = false;
+        }
+    }
+    fprintf(f, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    return fclose(f) == 0;
+}
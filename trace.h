@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2023 <mattdo@email.unc.edu>
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "include/GTime.h"
+#include "include/GTrace.h"
+
+enum TracePhase {
+    kTransform_Phase,
+    kClip_Phase,
+    kSort_Phase,
+    kScan_Phase,    // the scan converter itself, excluding the sort and blit time nested in it
+    kBlit_Phase,
+};
+constexpr int kTracePhaseCount = 5;
+
+struct TraceEvent {
+    const char* fOp;
+    GNSec       fStart;
+    GNSec       fDuration;
+    GNSec       fPhases[kTracePhaseCount];
+    int         fVertices;
+    int         fEdges;
+    int         fLeft, fTop, fRight, fBottom;   // device bounds of the pixels touched
+    uint64_t    fPixels;
+
+    // for the phases timed by TraceSampledTimer: how often each was entered, and the time of
+    // the sampled entries
+    uint64_t    fEntries[kTracePhaseCount];
+    GNSec       fSampled[kTracePhaseCount];
+};
+
+/*
+ * One entry in this many is timed by TraceSampledTimer.
+ */
+constexpr uint64_t kTraceSampleInterval = 16;
+
+extern std::atomic<bool> gTraceEnabled;
+extern thread_local TraceEvent* gTraceEvent;
+
+/*
+ * Records one draw call as an event, if tracing is on when it is constructed. The pipeline
+ * stages find the event through gTraceEvent (null when not tracing) and fill it in. A draw made
+ * by another draw (e.g. a rotated drawRect) is folded into the outer event.
+ */
+class TraceScope {
+private:
+    TraceEvent fEvent;
+    bool fActive;
+public:
+    explicit TraceScope(const char op[])
+            : fActive(!gTraceEvent && gTraceEnabled.load(std::memory_order_relaxed)) {
+        if (fActive) {
+            fEvent = {};
+            fEvent.fOp = op;
+            fEvent.fLeft = fEvent.fTop = INT32_MAX;
+            fEvent.fRight = fEvent.fBottom = INT32_MIN;
+            fEvent.fStart = GTime::GetNSec();
+            gTraceEvent = &fEvent;
+        }
+    }
+    ~TraceScope();
+};
+
+/*
+ * Adds the time until it goes out of scope to a phase of the current event.
+ */
+class TracePhaseTimer {
+private:
+    TracePhase fPhase;
+    GNSec fStart;
+public:
+    explicit TracePhaseTimer(TracePhase phase)
+            : fPhase(phase), fStart(gTraceEvent ? GTime::GetNSec() : 0) {}
+    ~TracePhaseTimer() {
+        if (gTraceEvent) {
+            gTraceEvent->fPhases[fPhase] += GTime::GetNSec() - fStart;
+        }
+    }
+};
+
+/*
+ * TracePhaseTimer for a phase entered once per span or scanline, where two clock reads on every
+ * entry would cost about as much as the work itself and inflate the phase being measured. Only
+ * every kTraceSampleInterval-th entry is timed; the event scales the sampled time up to all of
+ * the entries when it is recorded.
+ */
+class TraceSampledTimer {
+private:
+    TracePhase fPhase;
+    GNSec fStart = 0;
+    bool fTimed = false;
+public:
+    explicit TraceSampledTimer(TracePhase phase) : fPhase(phase) {
+        if (TraceEvent* ev = gTraceEvent) {
+            fTimed = ev->fEntries[phase]++ % kTraceSampleInterval == 0;
+            if (fTimed) {
+                fStart = GTime::GetNSec();
+            }
+        }
+    }
+    ~TraceSampledTimer() {
+        if (fTimed) {
+            gTraceEvent->fSampled[fPhase] += GTime::GetNSec() - fStart;
+        }
+    }
+};
+
+/*
+ * Add pixels in [left, right) x [top, bottom) to the current event (which must exist).
+ */
+static inline void trace_pixels(int left, int top, int right, int bottom) {
+    TraceEvent* ev = gTraceEvent;
+    ev->fPixels += (uint64_t) (right - left) * (bottom - top);
+    ev->fLeft = std::min(ev->fLeft, left);
+    ev->fTop = std::min(ev->fTop, top);
+    ev->fRight = std::max(ev->fRight, right);
+    ev->fBottom = std::max(ev->fBottom, bottom);
+}
+
+static inline void trace_counts(int vertices, int edges) {
+    if (gTraceEvent) {
+        gTraceEvent->fVertices = vertices;
+        gTraceEvent->fEdges = edges;
+    }
+}
+
+#endif
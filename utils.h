@@ -6,6 +6,7 @@
 #define UTILS_H_
 
 #include "include/GColor.h"
+#include "include/GColorFilter.h"
 #include "include/GPaint.h"
 #include "include/GPixel.h"
 #include "include/GMatrix.h"
@@ -19,13 +20,20 @@ static inline GPixel color_to_pixel(const GColor &color) {
     return GPixel_PackARGB(a, r, g, b);
 }
 
+// The paint's color, through its color filter (if any). Solid draws fold the filter in here,
+// once per draw instead of once per pixel.
+static inline GColor paint_color(const GPaint &paint) {
+    const GColorFilter* filter = paint.getColorFilter();
+    return filter ? filter->filterColor(paint.getColor()) : paint.getColor();
+}
+
 static inline bool null_draw(const GPaint &paint) {
     if (paint.getShader()) return false;
     switch (paint.getBlendMode()) {
         case GBlendMode::kSrcOver:
         case GBlendMode::kDstOut:
         case GBlendMode::kDstOver:
-            return paint.getAlpha() == 0;
+            return paint_color(paint).a == 0;
         case GBlendMode::kDst:
             return true;
         default: